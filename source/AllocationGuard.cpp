@@ -0,0 +1,140 @@
+#include "AllocationGuard.h"
+
+#if JUCE_DEBUG
+
+#include <cstdlib>
+#include <new>
+
+#if JUCE_LINUX && defined (__GLIBC__)
+extern "C"
+{
+    void* __libc_malloc(std::size_t);
+    void* __libc_calloc(std::size_t, std::size_t);
+    void* __libc_realloc(void*, std::size_t);
+}
+#endif
+
+namespace
+{
+    thread_local bool allocationForbidden = false;
+
+    void* allocate(std::size_t size) noexcept
+    {
+        ScopedAllocationGuard::checkAllocation();
+
+       #if JUCE_LINUX && defined (__GLIBC__)
+        // malloc is replaced below and would check the same allocation again
+        return __libc_malloc(size == 0 ? 1 : size);
+       #else
+        return std::malloc(size == 0 ? 1 : size);
+       #endif
+    }
+}
+
+ScopedAllocationGuard::ScopedAllocationGuard() noexcept
+    : wasGuarded(allocationForbidden)
+{
+    allocationForbidden = true;
+}
+
+ScopedAllocationGuard::~ScopedAllocationGuard() noexcept
+{
+    allocationForbidden = wasGuarded;
+}
+
+void ScopedAllocationGuard::checkAllocation() noexcept
+{
+    if (allocationForbidden) {
+        // The assertion handler may allocate itself, so lift the guard while it runs
+        allocationForbidden = false;
+        jassertfalse;
+        allocationForbidden = true;
+    }
+}
+
+// Replace the global allocation functions so that every new/delete made by
+// this binary goes through the guard
+void* operator new(std::size_t size)
+{
+    if (auto* ptr = allocate(size)) {
+        return ptr;
+    }
+
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return allocate(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+#if JUCE_LINUX && defined (__GLIBC__)
+// HeapBlock and AudioBuffer allocate with malloc directly. The plugin is built
+// with hidden visibility, so these only intercept calls made from our own code.
+extern "C"
+{
+    void* malloc(std::size_t size) noexcept
+    {
+        ScopedAllocationGuard::checkAllocation();
+        return __libc_malloc(size);
+    }
+
+    void* calloc(std::size_t numElements, std::size_t size) noexcept
+    {
+        ScopedAllocationGuard::checkAllocation();
+        return __libc_calloc(numElements, size);
+    }
+
+    void* realloc(void* ptr, std::size_t size) noexcept
+    {
+        ScopedAllocationGuard::checkAllocation();
+        return __libc_realloc(ptr, size);
+    }
+}
+#endif
+
+#else
+
+ScopedAllocationGuard::ScopedAllocationGuard() noexcept
+{
+}
+
+ScopedAllocationGuard::~ScopedAllocationGuard() noexcept
+{
+}
+
+void ScopedAllocationGuard::checkAllocation() noexcept
+{
+}
+
+#endif
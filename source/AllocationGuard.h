@@ -0,0 +1,22 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Debug-only guard for real-time code. While an instance is alive, any heap
+// allocation made on the same thread triggers an assertion. In release builds
+// it compiles to nothing.
+class ScopedAllocationGuard
+{
+public:
+    ScopedAllocationGuard() noexcept;
+    ~ScopedAllocationGuard() noexcept;
+
+    static void checkAllocation() noexcept;
+
+private:
+   #if JUCE_DEBUG
+    bool wasGuarded;
+   #endif
+
+    JUCE_DECLARE_NON_COPYABLE (ScopedAllocationGuard)
+};
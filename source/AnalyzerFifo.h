@@ -0,0 +1,98 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "PaddedFifo.h"
+
+// Wait-free single-producer/single-consumer queue of analyzer blocks. The
+// audio thread writes the dry and wet taps straight into a preallocated slot
+// and hands it over through a PaddedFifo once it is full, so the reader only
+// ever sees complete blocks and never touches a slot being written. Aligned
+// to a cache line, so it shares none with its neighbours.
+template <int blockSize, int numSlots>
+class alignas(cacheLineSize) AnalyzerFifo
+{
+public:
+    struct Block
+    {
+        float dry[blockSize];
+        float wet[blockSize];
+    };
+
+    AnalyzerFifo()
+        : fifo(numSlots)
+    {
+    }
+
+    // Called from the audio thread only
+    void push(const float* drySamples, const float* wetSamples, int numSamples) noexcept
+    {
+        while (numSamples > 0) {
+            if (writeSlot < 0 && !acquireWriteSlot()) {
+                // The reader is behind, drop the samples until a slot frees up
+                return;
+            }
+
+            auto& block = slots[(size_t)writeSlot];
+            const auto numToCopy = jmin(numSamples, blockSize - writePosition);
+
+            FloatVectorOperations::copy(block.dry + writePosition, drySamples, numToCopy);
+            FloatVectorOperations::copy(block.wet + writePosition, wetSamples, numToCopy);
+
+            writePosition += numToCopy;
+            drySamples += numToCopy;
+            wetSamples += numToCopy;
+            numSamples -= numToCopy;
+
+            if (writePosition == blockSize) {
+                // Publish the block
+                fifo.finishedWrite(1);
+                writeSlot = -1;
+                writePosition = 0;
+            }
+        }
+    }
+
+    // Called from the reading thread only. Passes every complete block to the
+    // callback in the order they were written and returns how many there were.
+    template <typename Callback>
+    int popAll(Callback&& callback)
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(fifo.getNumReady(), start1, size1, start2, size2);
+
+        for (int i = 0; i < size1; ++i) {
+            callback(slots[(size_t)(start1 + i)]);
+        }
+
+        for (int i = 0; i < size2; ++i) {
+            callback(slots[(size_t)(start2 + i)]);
+        }
+
+        fifo.finishedRead(size1 + size2);
+        return size1 + size2;
+    }
+
+private:
+    bool acquireWriteSlot() noexcept
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite(1, start1, size1, start2, size2);
+
+        if (size1 == 0) {
+            return false;
+        }
+
+        writeSlot = start1;
+        writePosition = 0;
+        return true;
+    }
+
+    PaddedFifo fifo;
+    alignas(cacheLineSize) std::array<Block, (size_t)numSlots> slots;
+
+    // Producer state, only touched by the audio thread
+    alignas(cacheLineSize) int writeSlot = -1;
+    int writePosition = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AnalyzerFifo)
+};
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// State written by different threads is kept this far apart, so writes on one
+// core never invalidate a line another core keeps reading. Apple silicon has
+// 128 byte lines, std::hardware_destructive_interference_size is not
+// available on every compiler the plugin builds with.
+//
+// PLUGIN_CACHE_LINE_PADDING=0 packs the same state together again, only so
+// the stress test can measure what the padding is worth.
+#ifndef PLUGIN_CACHE_LINE_PADDING
+ #define PLUGIN_CACHE_LINE_PADDING 1
+#endif
+
+#if !PLUGIN_CACHE_LINE_PADDING
+constexpr size_t cacheLineSize = alignof(std::max_align_t);
+#elif JUCE_MAC && JUCE_ARM
+constexpr size_t cacheLineSize = 128;
+#else
+constexpr size_t cacheLineSize = 64;
+#endif
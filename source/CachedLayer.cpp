@@ -0,0 +1,36 @@
+#include "CachedLayer.h"
+
+void CachedLayer::render(Rectangle<int> newArea, float newScale, const Renderer& renderer)
+{
+    area = newArea;
+    scale = newScale;
+
+    if (area.isEmpty()) {
+        image = {};
+        return;
+    }
+
+    // One image pixel per physical pixel, so the blit does not resample
+    image = Image(Image::ARGB, roundToInt((float)area.getWidth() * scale), roundToInt((float)area.getHeight() * scale), true);
+
+    Graphics g(image);
+    g.addTransform(AffineTransform::translation((float)-area.getX(), (float)-area.getY()).scaled(scale));
+    renderer(g);
+}
+
+void CachedLayer::draw(Graphics& g) const
+{
+    if (image.isValid()) {
+        g.drawImage(image, area.toFloat());
+    }
+}
+
+bool CachedLayer::isValid() const
+{
+    return image.isValid();
+}
+
+float CachedLayer::getScale() const
+{
+    return scale;
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// A static part of a component, rendered once into an image at the physical
+// pixel scale of the display and drawn with a single blit on every repaint.
+// The owner renders it again when its bounds, the scale or its content change.
+class CachedLayer
+{
+public:
+    using Renderer = std::function<void(Graphics&)>;
+
+    // Renders the area in component coordinates, the renderer draws in the same coordinates
+    void render(Rectangle<int>, float, const Renderer&);
+
+    void draw(Graphics&) const;
+
+    bool isValid() const;
+    float getScale() const;
+
+private:
+    Image image;
+    Rectangle<int> area;
+    float scale = 1.0f;
+};
@@ -0,0 +1,377 @@
+#include "Compressor.h"
+#include "FastMath.h"
+
+namespace
+{
+    // Levels and gains are float in both precisions
+    void absToLevels(float* levels, const float* samples, int numSamples)
+    {
+        FloatVectorOperations::abs(levels, samples, numSamples);
+    }
+
+    void absToLevels(float* levels, const double* samples, int numSamples)
+    {
+        for (int i = 0; i < numSamples; ++i) {
+            levels[i] = (float)std::abs(samples[i]);
+        }
+    }
+
+    void multiplyByGains(float* output, const float* input, const float* gains, int numSamples)
+    {
+        FloatVectorOperations::multiply(output, input, gains, numSamples);
+    }
+
+    void multiplyByGains(double* output, const double* input, const float* gains, int numSamples)
+    {
+        for (int i = 0; i < numSamples; ++i) {
+            output[i] = input[i] * (double)gains[i];
+        }
+    }
+}
+
+Compressor::Compressor()
+{
+    updateCoefficients();
+}
+
+void Compressor::prepare(const dsp::ProcessSpec& spec)
+{
+    jassert(spec.sampleRate > 0);
+    jassert(spec.numChannels > 0);
+
+    sampleRate = spec.sampleRate;
+    numChannels = (size_t)spec.numChannels;
+
+    envelopes.resize(numChannels);
+    levels.resize(numChannels * sectionSize);
+
+    updateCoefficients();
+    reset();
+}
+
+void Compressor::reset()
+{
+    std::fill(envelopes.begin(), envelopes.end(), 0.0f);
+    maxGainReductionLog2 = 0.0f;
+}
+
+void Compressor::setThreshold(float newThresholddB)
+{
+    if (newThresholddB == thresholddB) {
+        return;
+    }
+
+    thresholddB = newThresholddB;
+    updateCoefficients();
+}
+
+void Compressor::setRatio(float newRatio)
+{
+    jassert(newRatio >= 1.0f);
+
+    if (newRatio == ratio) {
+        return;
+    }
+
+    ratio = newRatio;
+    updateCoefficients();
+}
+
+void Compressor::setAttack(float newAttackTime)
+{
+    if (newAttackTime == attackTime) {
+        return;
+    }
+
+    attackTime = newAttackTime;
+    updateCoefficients();
+}
+
+void Compressor::setRelease(float newReleaseTime)
+{
+    if (newReleaseTime == releaseTime) {
+        return;
+    }
+
+    releaseTime = newReleaseTime;
+    updateCoefficients();
+}
+
+void Compressor::setDetection(Detection newDetection)
+{
+    detection = newDetection;
+}
+
+template <typename SampleType>
+void Compressor::process(const dsp::AudioBlock<SampleType>& block)
+{
+    process(block, block, block);
+}
+
+template <typename SampleType>
+void Compressor::process(const dsp::AudioBlock<SampleType>& sidechain, const dsp::AudioBlock<SampleType>& input, const dsp::AudioBlock<SampleType>& output)
+{
+    const auto numSamples = output.getNumSamples();
+    const auto numBlockChannels = output.getNumChannels();
+
+    jassert(numBlockChannels <= numChannels);
+    jassert(sidechain.getNumChannels() == numBlockChannels && sidechain.getNumSamples() == numSamples);
+    jassert(input.getNumChannels() == numBlockChannels && input.getNumSamples() == numSamples);
+
+    // Mid/side needs a stereo pair, anything else is detected per channel
+    auto mode = detection;
+
+    if (mode == Detection::midSide && numBlockChannels != 2) {
+        mode = Detection::perChannel;
+    }
+
+    const bool linked = mode == Detection::maxLinked || mode == Detection::averageLinked;
+    const auto numDetectors = linked ? (size_t)1 : numBlockChannels;
+
+    for (size_t startSample = 0; startSample < numSamples; startSample += sectionSize) {
+        const auto length = jmin(sectionSize, numSamples - startSample);
+        const auto inputSection = input.getSubBlock(startSample, length);
+        const auto outputSection = output.getSubBlock(startSample, length);
+
+        detect(sidechain.getSubBlock(startSample, length), mode, numBlockChannels);
+
+        // Below the threshold every gain is exactly one, so there is nothing to apply
+        const auto highestEnvelope = followEnvelopes(numDetectors, length);
+
+        if (highestEnvelope > thresholdLevel) {
+            maxGainReductionLog2 = jmax(maxGainReductionLog2, -slope * (std::log2(highestEnvelope) - thresholdLog2));
+
+            computeGains(numDetectors, length);
+            applyGains(inputSection, outputSection, mode, numBlockChannels);
+        }
+        else if (inputSection.getChannelPointer(0) != outputSection.getChannelPointer(0)) {
+            for (size_t channel = 0; channel < numBlockChannels; ++channel) {
+                FloatVectorOperations::copy(outputSection.getChannelPointer(channel), inputSection.getChannelPointer(channel), (int)length);
+            }
+        }
+    }
+}
+
+void Compressor::snapToZero()
+{
+   #if JUCE_DSP_ENABLE_SNAP_TO_ZERO
+    for (auto& envelope : envelopes) {
+        JUCE_SNAP_TO_ZERO(envelope);
+    }
+   #endif
+}
+
+bool Compressor::isSettled(float level) const
+{
+    for (auto envelope : envelopes) {
+        if (envelope > level) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+float Compressor::getAndResetGainReduction()
+{
+    // 20 * log10(2) dB per log2 unit, as in updateCoefficients
+    const auto gainReduction = 6.020599913f * maxGainReductionLog2;
+    maxGainReductionLog2 = 0.0f;
+    return gainReduction;
+}
+
+template <typename SampleType>
+void Compressor::detect(const dsp::AudioBlock<SampleType>& section, Detection mode, size_t numBlockChannels)
+{
+    const auto numSamples = (int)section.getNumSamples();
+    auto* levels0 = levels.data();
+
+    switch (mode) {
+        case Detection::perChannel:
+            for (size_t channel = 0; channel < numBlockChannels; ++channel) {
+                absToLevels(levels0 + channel * sectionSize, section.getChannelPointer(channel), numSamples);
+            }
+            break;
+
+        case Detection::maxLinked:
+            absToLevels(levels0, section.getChannelPointer(0), numSamples);
+
+            for (size_t channel = 1; channel < numBlockChannels; ++channel) {
+                const auto* samples = section.getChannelPointer(channel);
+
+                for (int i = 0; i < numSamples; ++i) {
+                    levels0[i] = jmax(levels0[i], (float)std::abs(samples[i]));
+                }
+            }
+            break;
+
+        case Detection::averageLinked:
+            absToLevels(levels0, section.getChannelPointer(0), numSamples);
+
+            for (size_t channel = 1; channel < numBlockChannels; ++channel) {
+                const auto* samples = section.getChannelPointer(channel);
+
+                for (int i = 0; i < numSamples; ++i) {
+                    levels0[i] += (float)std::abs(samples[i]);
+                }
+            }
+
+            FloatVectorOperations::multiply(levels0, 1.0f / (float)numBlockChannels, numSamples);
+            break;
+
+        case Detection::midSide:
+        {
+            const auto* left = section.getChannelPointer(0);
+            const auto* right = section.getChannelPointer(1);
+            auto* levels1 = levels0 + sectionSize;
+
+            for (int i = 0; i < numSamples; ++i) {
+                levels0[i] = (float)std::abs(0.5f * (left[i] + right[i]));
+                levels1[i] = (float)std::abs(0.5f * (left[i] - right[i]));
+            }
+            break;
+        }
+    }
+}
+
+float Compressor::followEnvelopes(size_t numDetectors, size_t numSamples)
+{
+    // Rising levels move the envelope by the attack step and falling ones by
+    // the release step. When the attack is the faster one the right step is
+    // always the larger of the two results, otherwise the smaller one, so a
+    // max or min replaces the branch that noisy material would mispredict.
+    if (attackCoefficient <= releaseCoefficient) {
+        return followEnvelopes<true>(numDetectors, numSamples);
+    }
+
+    return followEnvelopes<false>(numDetectors, numSamples);
+}
+
+template <bool attackIsFaster>
+float Compressor::followEnvelopes(size_t numDetectors, size_t numSamples)
+{
+    // Peak ballistics with the dsp::BallisticsFilter time constants
+    const auto attackGain = 1.0f - attackCoefficient;
+    const auto releaseGain = 1.0f - releaseCoefficient;
+    auto peak = 0.0f;
+
+    auto follow = [&](float level, float& envelope) {
+        const auto attacked = attackCoefficient * envelope + attackGain * level;
+        const auto released = releaseCoefficient * envelope + releaseGain * level;
+        envelope = attackIsFaster ? jmax(attacked, released) : jmin(attacked, released);
+        peak = jmax(peak, envelope);
+        return envelope;
+    };
+
+    size_t detector = 0;
+
+    // Run the detectors in pairs, so the two recursions overlap
+    for (; detector + 1 < numDetectors; detector += 2) {
+        auto* firstLevels = levels.data() + detector * sectionSize;
+        auto* secondLevels = firstLevels + sectionSize;
+        auto firstEnvelope = envelopes[detector];
+        auto secondEnvelope = envelopes[detector + 1];
+
+        for (size_t i = 0; i < numSamples; ++i) {
+            firstLevels[i] = follow(firstLevels[i], firstEnvelope);
+            secondLevels[i] = follow(secondLevels[i], secondEnvelope);
+        }
+
+        envelopes[detector] = firstEnvelope;
+        envelopes[detector + 1] = secondEnvelope;
+    }
+
+    if (detector < numDetectors) {
+        auto* detectorLevels = levels.data() + detector * sectionSize;
+        auto envelope = envelopes[detector];
+
+        for (size_t i = 0; i < numSamples; ++i) {
+            detectorLevels[i] = follow(detectorLevels[i], envelope);
+        }
+
+        envelopes[detector] = envelope;
+    }
+
+    return peak;
+}
+
+void Compressor::computeGains(size_t numDetectors, size_t numSamples)
+{
+    // Keeps log2 finite for silent envelopes, far below any threshold
+    constexpr float minimumLevel = 1.0e-20f;
+
+    for (size_t detector = 0; detector < numDetectors; ++detector) {
+        auto* gains = levels.data() + detector * sectionSize;
+
+        // Above the threshold the gain is (envelope / threshold)^(1 / ratio - 1).
+        // min(0, x) is written with abs so the loop has no comparisons.
+        for (size_t i = 0; i < numSamples; ++i) {
+            const auto gainLog2 = slope * (FastMath::log2(gains[i] + minimumLevel) - thresholdLog2);
+            gains[i] = FastMath::exp2(0.5f * (gainLog2 - std::abs(gainLog2)));
+        }
+    }
+}
+
+template <typename SampleType>
+void Compressor::applyGains(const dsp::AudioBlock<SampleType>& input, const dsp::AudioBlock<SampleType>& output, Detection mode, size_t numBlockChannels)
+{
+    const auto numSamples = (int)output.getNumSamples();
+    const auto* gains0 = levels.data();
+
+    switch (mode) {
+        case Detection::perChannel:
+            for (size_t channel = 0; channel < numBlockChannels; ++channel) {
+                multiplyByGains(output.getChannelPointer(channel), input.getChannelPointer(channel), gains0 + channel * sectionSize, numSamples);
+            }
+            break;
+
+        case Detection::maxLinked:
+        case Detection::averageLinked:
+            for (size_t channel = 0; channel < numBlockChannels; ++channel) {
+                multiplyByGains(output.getChannelPointer(channel), input.getChannelPointer(channel), gains0, numSamples);
+            }
+            break;
+
+        case Detection::midSide:
+        {
+            const auto* left = input.getChannelPointer(0);
+            const auto* right = input.getChannelPointer(1);
+            auto* leftOut = output.getChannelPointer(0);
+            auto* rightOut = output.getChannelPointer(1);
+            const auto* gains1 = gains0 + sectionSize;
+
+            for (int i = 0; i < numSamples; ++i) {
+                const auto mid = 0.5f * (left[i] + right[i]) * gains0[i];
+                const auto side = 0.5f * (left[i] - right[i]) * gains1[i];
+
+                leftOut[i] = mid + side;
+                rightOut[i] = mid - side;
+            }
+            break;
+        }
+    }
+}
+
+float Compressor::getCoefficient(float timeMs) const
+{
+    // Same time constant as dsp::BallisticsFilter
+    if (timeMs < 1.0e-3f) {
+        return 0.0f;
+    }
+
+    return (float)std::exp(-2.0 * MathConstants<double>::pi * 1000.0 / sampleRate / (double)timeMs);
+}
+
+void Compressor::updateCoefficients()
+{
+    thresholdLog2 = thresholddB / 6.020599913f;
+    thresholdLevel = std::exp2(thresholdLog2);
+    slope = 1.0f / ratio - 1.0f;
+    attackCoefficient = getCoefficient(attackTime);
+    releaseCoefficient = getCoefficient(releaseTime);
+}
+
+template void Compressor::process<float>(const dsp::AudioBlock<float>&);
+template void Compressor::process<double>(const dsp::AudioBlock<double>&);
+template void Compressor::process<float>(const dsp::AudioBlock<float>&, const dsp::AudioBlock<float>&, const dsp::AudioBlock<float>&);
+template void Compressor::process<double>(const dsp::AudioBlock<double>&, const dsp::AudioBlock<double>&, const dsp::AudioBlock<double>&);
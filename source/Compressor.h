@@ -0,0 +1,94 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Peak compressor with the same ballistics and gain curve as dsp::Compressor,
+// with a selectable detection. The envelope recursion is the only serial
+// part, the gain computer works on whole sections in the log2 domain with
+// the FastMath approximations, so it is vectorised by the compiler.
+class Compressor
+{
+public:
+    enum class Detection
+    {
+        perChannel,     // Every channel ducks on its own
+        maxLinked,      // All channels follow the loudest one
+        averageLinked,  // All channels follow their average level
+        midSide         // Mid and side are compressed separately, stereo only
+    };
+
+    Compressor();
+
+    void prepare(const dsp::ProcessSpec&);
+    void reset();
+
+    void setThreshold(float);
+    void setRatio(float);
+    void setAttack(float);
+    void setRelease(float);
+    void setDetection(Detection);
+
+    // Compresses the block in place, it must not have more channels than prepared.
+    // Both precisions share the envelopes, the gain computer always runs in float.
+    template <typename SampleType>
+    void process(const dsp::AudioBlock<SampleType>&);
+
+    // Compresses input into output with the gains detected on the sidechain,
+    // for lookahead. The output may be the input or the sidechain block.
+    template <typename SampleType>
+    void process(const dsp::AudioBlock<SampleType>&, const dsp::AudioBlock<SampleType>&, const dsp::AudioBlock<SampleType>&);
+
+    // Flushes tiny envelopes to zero, call once at the end of each block
+    void snapToZero();
+
+    // True once every envelope has released to the given level, from then on
+    // reset changes nothing audible
+    bool isSettled(float) const;
+
+    // Largest gain reduction in dB since the last call, for metering
+    float getAndResetGainReduction();
+
+    // Blocks are worked through in sections of this size. Splitting a block
+    // on multiples of it gives the same output as processing it at once.
+    constexpr static size_t sectionSize = 64;
+
+private:
+    void updateCoefficients();
+    template <typename SampleType>
+    void detect(const dsp::AudioBlock<SampleType>&, Detection, size_t);
+
+    // Return the highest envelope of the section
+    float followEnvelopes(size_t, size_t);
+    template <bool attackIsFaster>
+    float followEnvelopes(size_t, size_t);
+
+    void computeGains(size_t, size_t);
+    template <typename SampleType>
+    void applyGains(const dsp::AudioBlock<SampleType>&, const dsp::AudioBlock<SampleType>&, Detection, size_t);
+
+    float getCoefficient(float) const;
+
+    double sampleRate = 44100.0;
+    size_t numChannels = 0;
+
+    float thresholddB = 0.0f;
+    float ratio = 1.0f;
+    float attackTime = 1.0f;
+    float releaseTime = 100.0f;
+    Detection detection = Detection::perChannel;
+
+    float thresholdLog2 = 0.0f;
+    float thresholdLevel = 1.0f;
+    float slope = 0.0f;
+    float attackCoefficient = 0.0f;
+    float releaseCoefficient = 0.0f;
+
+    // Largest gain reduction in log2 units, taken from the highest envelope of every section
+    float maxGainReductionLog2 = 0.0f;
+
+    // One envelope per detector, and detector levels turned into gains in place
+    std::vector<float> envelopes;
+    std::vector<float> levels;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Compressor)
+};
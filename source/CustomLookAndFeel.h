@@ -1,6 +1,7 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "CachedLayer.h"
 
 class CustomLookAndFeel : public LookAndFeel_V4
 {
@@ -27,8 +28,11 @@ public:
 		}
 
         // Draw shadow
-		DropShadow shadow(Colour::fromRGBA(0x00, 0x00, 0x00, 0x44), 15, Point<int>(5, 5));
-        shadow.drawForRectangle(g, backgroundRect.toNearestInt());
+		const auto shadowRect = backgroundRect.toNearestInt();
+		getLayer(Layer::sliderShadow, shadowRect, g, [shadowRect](Graphics& layer) {
+			DropShadow shadow(Colour::fromRGBA(0x00, 0x00, 0x00, 0x44), shadowRadius, Point<int>(5, 5));
+			shadow.drawForRectangle(layer, shadowRect);
+		}).draw(g);
 
         // Draw background
         g.setColour(Colour::fromRGBA(0x32, 0x3E, 0x49, 0xAA));
@@ -50,17 +54,22 @@ public:
 		buttonPath.addEllipse(buttonRect);
 
 		// Draw shadow and light
-		DropShadow shadow(Colour::fromRGBA(0x00, 0x00, 0x00, 0x66), 15, Point<int>(5, 5));
-		DropShadow light(Colour::fromRGBA(0x48, 0x47, 0x4D, 0x20), 15, Point<int>(-5, -5));
-		DropShadow glow(Colour::fromRGBA(0xF6, 0xEF, 0xDE, 0x44), 15, Point<int>(0, 0));
-		shadow.drawForPath(g, buttonPath);
-		light.drawForPath(g, buttonPath);
+		getLayer(Layer::buttonShadow, buttonRect.toNearestInt(), g, [buttonPath](Graphics& layer) {
+			DropShadow shadow(Colour::fromRGBA(0x00, 0x00, 0x00, 0x66), shadowRadius, Point<int>(5, 5));
+			DropShadow light(Colour::fromRGBA(0x48, 0x47, 0x4D, 0x20), shadowRadius, Point<int>(-5, -5));
+			shadow.drawForPath(layer, buttonPath);
+			light.drawForPath(layer, buttonPath);
+		}).draw(g);
 
 		// Draw button
 		if (!button.getToggleState()) {
 			g.setColour(Colour(0xF6, 0xEF, 0xDE));
 			g.fillPath(buttonPath);
-			glow.drawForPath(g, buttonPath);
+
+			getLayer(Layer::buttonGlow, buttonRect.toNearestInt(), g, [buttonPath](Graphics& layer) {
+				DropShadow glow(Colour::fromRGBA(0xF6, 0xEF, 0xDE, 0x44), shadowRadius, Point<int>(0, 0));
+				glow.drawForPath(layer, buttonPath);
+			}).draw(g);
 		}
 		else {
 			// Draw button
@@ -68,4 +77,41 @@ public:
 			g.fillPath(buttonPath);
 		}
 	}
+
+private:
+	// The blurred layers only depend on the bounds of what they are drawn
+	// around, the state and the display scale, so each one is rendered once
+	// per combination and blitted on every repaint after that
+	enum class Layer
+	{
+		sliderShadow,
+		buttonShadow,
+		buttonGlow
+	};
+
+	const CachedLayer& getLayer(Layer type, Rectangle<int> bounds, Graphics& g, const CachedLayer::Renderer& renderer) {
+		const auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+		const auto key = std::make_tuple((int)type, bounds.getX(), bounds.getY(), bounds.getWidth(), bounds.getHeight(), scale);
+		auto found = layers.find(key);
+
+		if (found == layers.end()) {
+			// Resizing may leave stale sizes behind, keep the cache small
+			if (layers.size() >= maxNumLayers) {
+				layers.clear();
+			}
+
+			found = layers.emplace(key, CachedLayer()).first;
+
+			// The blur and its offset reach this far around the bounds
+			found->second.render(bounds.expanded(shadowRadius + shadowOffset), scale, renderer);
+		}
+
+		return found->second;
+	}
+
+	constexpr static int shadowRadius = 15;
+	constexpr static int shadowOffset = 5;
+	constexpr static size_t maxNumLayers = 32;
+
+	std::map<std::tuple<int, int, int, int, int, float>, CachedLayer> layers;
 };
@@ -0,0 +1,76 @@
+#include "CutoffModulator.h"
+#include "FastMath.h"
+
+void CutoffModulator::prepare(double newSampleRate)
+{
+    jassert(newSampleRate > 0);
+
+    sampleRate = newSampleRate;
+    updateCoefficients();
+    reset();
+}
+
+void CutoffModulator::reset()
+{
+    phase = 0.0f;
+    envelope = 0.0f;
+}
+
+void CutoffModulator::setSource(Source newSource)
+{
+    source = newSource;
+}
+
+void CutoffModulator::setDepth(float newDepthInOctaves)
+{
+    depth = newDepthInOctaves;
+}
+
+void CutoffModulator::setRate(float newRate)
+{
+    rate = newRate;
+}
+
+bool CutoffModulator::isActive() const
+{
+    return source != Source::off && depth != 0.0f;
+}
+
+template <typename SampleType>
+float CutoffModulator::getNextMultiplier(const dsp::AudioBlock<SampleType>& step)
+{
+    const auto numSamples = step.getNumSamples();
+    auto modulation = 0.0f;
+
+    if (source == Source::lfo) {
+        phase += rate * (float)numSamples / (float)sampleRate;
+        phase -= std::floor(phase);
+        modulation = std::sin(MathConstants<float>::twoPi * phase);
+    }
+    else if (source == Source::envelope) {
+        // Follow the peak of the step across all channels
+        auto peak = 0.0f;
+
+        for (size_t channel = 0; channel < step.getNumChannels(); ++channel) {
+            const auto range = FloatVectorOperations::findMinAndMax(step.getChannelPointer(channel), (int)numSamples);
+            peak = jmax(peak, (float)-range.getStart(), (float)range.getEnd());
+        }
+
+        const auto coefficient = peak > envelope ? attackCoefficient : releaseCoefficient;
+        envelope = peak + coefficient * (envelope - peak);
+        modulation = jmin(envelope, 1.0f);
+    }
+
+    return FastMath::exp2(depth * modulation);
+}
+
+void CutoffModulator::updateCoefficients()
+{
+    const auto stepTime = (double)stepSize / sampleRate;
+
+    attackCoefficient = (float)std::exp(-stepTime / attackTime);
+    releaseCoefficient = (float)std::exp(-stepTime / releaseTime);
+}
+
+template float CutoffModulator::getNextMultiplier<float>(const dsp::AudioBlock<float>&);
+template float CutoffModulator::getNextMultiplier<double>(const dsp::AudioBlock<double>&);
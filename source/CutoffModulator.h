@@ -0,0 +1,57 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Modulation source for the highpass cutoff, either a sine LFO or an
+// envelope follower on the signal that is being filtered. It is advanced once
+// per step of stepSize samples and returns a cutoff multiplier for the end of
+// each step, the filter ramps its coefficients in between.
+class CutoffModulator
+{
+public:
+    enum class Source
+    {
+        off,
+        lfo,        // Sweeps down and up by the depth
+        envelope    // Moves up by the depth as the level reaches full scale
+    };
+
+    CutoffModulator() = default;
+
+    void prepare(double);
+    void reset();
+
+    void setSource(Source);
+    void setDepth(float);
+    void setRate(float);
+
+    bool isActive() const;
+
+    // Advances over one step of the block and returns the multiplier for its end
+    template <typename SampleType>
+    float getNextMultiplier(const dsp::AudioBlock<SampleType>&);
+
+    constexpr static size_t stepSize = 16;
+
+private:
+    void updateCoefficients();
+
+    double sampleRate = 44100.0;
+
+    Source source = Source::off;
+    float depth = 0.0f;
+    float rate = 1.0f;
+
+    // LFO phase in cycles
+    float phase = 0.0f;
+
+    // Envelope follower, with coefficients per step
+    float envelope = 0.0f;
+    float attackCoefficient = 0.0f;
+    float releaseCoefficient = 0.0f;
+
+    constexpr static double attackTime = 0.005;
+    constexpr static double releaseTime = 0.1;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CutoffModulator)
+};
@@ -0,0 +1,170 @@
+#include "DiagnosticsPanel.h"
+
+namespace
+{
+    // Risk thresholds as a proportion of the block deadline, in the order of the combo box
+    const float riskThresholds[] = { 0.5f, 0.75f, 0.9f };
+}
+
+DiagnosticsPanel::DiagnosticsPanel(Processor& p)
+    : stats(p.getProcessingStats())
+{
+    toggleButton.setButtonText("Diagnostics");
+    toggleButton.onClick = [this] { setExpanded(!expanded); };
+    addAndMakeVisible(toggleButton);
+
+    resetButton.setButtonText("Reset");
+    resetButton.onClick = [this] { stats.reset(); };
+    addChildComponent(resetButton);
+
+    for (int i = 0; i < (int)std::size(riskThresholds); ++i) {
+        thresholdBox.addItem("Risk above " + String(roundToInt(100.0f * riskThresholds[i])) + " %", i + 1);
+
+        if (riskThresholds[i] == stats.getRiskThreshold()) {
+            thresholdBox.setSelectedId(i + 1, dontSendNotification);
+        }
+    }
+
+    thresholdBox.onChange = [this] {
+        stats.setRiskThreshold(riskThresholds[thresholdBox.getSelectedId() - 1]);
+        stats.reset();
+    };
+    addChildComponent(thresholdBox);
+
+   #if PLUGIN_TRACING
+    traceButton.setButtonText("Trace");
+    traceButton.onClick = [] {
+        const auto file = File::getSpecialLocation(File::userDesktopDirectory).getNonexistentChildFile("There will be blood trace", ".json");
+        TraceRecorder::getInstance().startCapture(file, traceSeconds);
+    };
+    addChildComponent(traceButton);
+   #endif
+}
+
+DiagnosticsPanel::~DiagnosticsPanel()
+{
+    stopTimer();
+    stats.setEnabled(false);
+}
+
+void DiagnosticsPanel::setExpanded(bool shouldBeExpanded)
+{
+    if (shouldBeExpanded == expanded) {
+        return;
+    }
+
+    expanded = shouldBeExpanded;
+
+    // Start every session from fresh figures
+    if (expanded) {
+        stats.reset();
+        stats.setEnabled(true);
+        startTimerHz(4);
+    }
+    else {
+        stopTimer();
+        stats.setEnabled(false);
+    }
+
+    resetButton.setVisible(expanded);
+    thresholdBox.setVisible(expanded);
+
+   #if PLUGIN_TRACING
+    traceButton.setVisible(expanded);
+   #endif
+
+    if (onExpandedChange != nullptr) {
+        onExpandedChange();
+    }
+
+    repaint();
+}
+
+bool DiagnosticsPanel::isExpanded() const
+{
+    return expanded;
+}
+
+void DiagnosticsPanel::paint (Graphics& g)
+{
+    if (!expanded) {
+        return;
+    }
+
+    g.setColour(Colour(0x18, 0x17, 0x1D).withAlpha(0.95f));
+    g.fillRoundedRectangle(getLocalBounds().toFloat(), 5.0f);
+
+    auto bounds = getLocalBounds().reduced(10);
+    bounds.removeFromTop(collapsedHeight + 4);
+
+    g.setColour(Colour(0xF6, 0xEF, 0xDE));
+    g.setFont(12.0f);
+
+    const auto callback = stats.getCallbackFigures();
+    const auto percent = [](float proportion) { return String(100.0f * proportion, 1) + " %"; };
+
+    drawRow(g, bounds.removeFromTop(18), "Load", percent((float)stats.getLoad()), "xruns", String(stats.getNumXRuns()));
+    drawRow(g, bounds.removeFromTop(18), "Callbacks", String(stats.getNumCallbacks()),
+            "above " + percent(stats.getRiskThreshold()), String(stats.getNumRiskyCallbacks()));
+
+    bounds.removeFromTop(6);
+    g.setColour(Colour(0xF6, 0xEF, 0xDE).withAlpha(0.6f));
+    drawRow(g, bounds.removeFromTop(18), "", "min", "avg", "max");
+
+    g.setColour(Colour(0xF6, 0xEF, 0xDE));
+    drawRow(g, bounds.removeFromTop(18), "Deadline used", percent(callback.minimum), percent(callback.average), percent(callback.maximum));
+
+    // Stage times in microseconds per callback
+    for (int stage = 0; stage < ProcessingStats::numStages; ++stage) {
+        const auto figures = stats.getStageFigures(stage);
+        const auto microseconds = [](float value) { return String(value, 1) + " us"; };
+
+        drawRow(g, bounds.removeFromTop(18), ProcessingStats::getStageName(stage),
+                microseconds(figures.minimum), microseconds(figures.average), microseconds(figures.maximum));
+    }
+}
+
+void DiagnosticsPanel::drawRow(Graphics& g, Rectangle<int> row, const String& label,
+                               const String& first, const String& second, const String& third) const
+{
+    g.drawText(label, row.removeFromLeft(row.getWidth() / 4 + 40), Justification::centredLeft);
+
+    const auto columnWidth = row.getWidth() / 3;
+
+    g.drawText(first, row.removeFromLeft(columnWidth), Justification::centredRight);
+    g.drawText(second, row.removeFromLeft(columnWidth), Justification::centredRight);
+    g.drawText(third, row, Justification::centredRight);
+}
+
+void DiagnosticsPanel::resized()
+{
+    // The toggle stays in the top right corner, collapsed it is all there is
+    auto bounds = getLocalBounds();
+
+    if (expanded) {
+        bounds = bounds.reduced(10);
+    }
+
+    auto header = bounds.removeFromTop(collapsedHeight);
+    toggleButton.setBounds(header.removeFromRight(collapsedWidth));
+
+    header.removeFromRight(10);
+    resetButton.setBounds(header.removeFromRight(60));
+    header.removeFromRight(10);
+    thresholdBox.setBounds(header.removeFromRight(140));
+
+   #if PLUGIN_TRACING
+    header.removeFromRight(10);
+    traceButton.setBounds(header.removeFromRight(60));
+   #endif
+}
+
+void DiagnosticsPanel::timerCallback()
+{
+   #if PLUGIN_TRACING
+    // Grey while a capture is being written
+    traceButton.setEnabled(!TraceRecorder::getInstance().isCapturing());
+   #endif
+
+    repaint();
+}
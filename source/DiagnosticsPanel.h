@@ -0,0 +1,45 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+
+// Collapsible view of the processing stats. The processor only times its
+// callbacks while the panel is expanded.
+class DiagnosticsPanel  : public Component, public Timer
+{
+public:
+    DiagnosticsPanel(Processor&);
+    ~DiagnosticsPanel() override;
+
+    void paint (Graphics&) override;
+    void resized() override;
+
+    void timerCallback() override;
+
+    void setExpanded(bool);
+    bool isExpanded() const;
+
+    // Called after the panel was expanded or collapsed, so the editor can lay it out again
+    std::function<void()> onExpandedChange;
+
+    constexpr static int collapsedWidth = 100;
+    constexpr static int collapsedHeight = 24;
+
+private:
+    void drawRow(Graphics&, Rectangle<int>, const String&, const String&, const String&, const String&) const;
+
+    ProcessingStats& stats;
+    bool expanded = false;
+
+    TextButton toggleButton;
+    TextButton resetButton;
+    ComboBox thresholdBox;
+
+   #if PLUGIN_TRACING
+    // Writes a timeline of the next seconds to the desktop
+    TextButton traceButton;
+    constexpr static double traceSeconds = 10.0;
+   #endif
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DiagnosticsPanel)
+};
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Branch-free approximations for the hot loops. They only use arithmetic and
+// bit casts, so loops over arrays of them can be vectorised by the compiler.
+namespace FastMath
+{
+    // log2 for positive normal numbers, accurate to about 2e-5
+    inline float log2(float x) noexcept
+    {
+        // Split into exponent and a mantissa in [1, 2)
+        uint32 bits;
+        std::memcpy(&bits, &x, sizeof(bits));
+        const auto exponent = (float)((int)((bits >> 23) & 0xff) - 127);
+        bits = (bits & 0x007fffffu) | 0x3f800000u;
+
+        float mantissa;
+        std::memcpy(&mantissa, &bits, sizeof(mantissa));
+
+        // log2(m) = 2 / ln(2) * atanh((m - 1) / (m + 1)), as an odd series
+        const auto t = (mantissa - 1.0f) / (mantissa + 1.0f);
+        const auto t2 = t * t;
+
+        return exponent + t * (2.885390082f + t2 * (0.961796694f + t2 * (0.577078016f + t2 * 0.412198583f)));
+    }
+
+    // 2^x, accurate to about 1e-5 relative, inputs are clamped to the normal range
+    inline float exp2(float x) noexcept
+    {
+        // Clamp with abs instead of comparisons, which would keep loops from
+        // being vectorised when floating point traps are honoured
+        x = 0.5f * (x - 126.0f + std::abs(x + 126.0f));
+        x = 0.5f * (x + 126.0f - std::abs(x - 126.0f));
+
+        // Offset by the exponent bias, so truncating rounds down
+        const auto biased = x + 127.0f;
+        const auto integer = (int)biased;
+        const auto fraction = biased - (float)integer;
+
+        // 2^fraction as a minimax polynomial, exact at 0
+        const auto mantissa = 1.0f + fraction * (0.69315308f + fraction * (0.24015361f + fraction * (0.055826318f + fraction * (0.0089893397f + fraction * 0.0018775767f))));
+
+        // Scale by 2^integer through the exponent bits
+        const auto bits = (uint32)integer << 23;
+        float scale;
+        std::memcpy(&scale, &bits, sizeof(scale));
+
+        return mantissa * scale;
+    }
+
+    // tan for 0 <= x < pi / 2, accurate to about 1e-6 relative up to 1.45.
+    // Used for filter coefficients that change too often for std::tan.
+    inline float tan(float x) noexcept
+    {
+        // Pade approximant, reflected through tan(x) = 1 / tan(pi / 2 - x) above pi / 4
+        auto pade = [](float y) {
+            const auto y2 = y * y;
+            return y * (945.0f - 105.0f * y2 + y2 * y2) / (945.0f - 420.0f * y2 + 15.0f * y2 * y2);
+        };
+
+        constexpr auto quarterPi = MathConstants<float>::pi * 0.25f;
+
+        if (x <= quarterPi) {
+            return pade(x);
+        }
+
+        return 1.0f / pade(MathConstants<float>::halfPi - x);
+    }
+
+    // Converts powers (squared gains) to decibels
+    inline void powerToDecibels(float* dest, const float* src, int numValues, float minusInfinityDb = -100.0f) noexcept
+    {
+        const auto minimumPower = std::pow(10.0f, minusInfinityDb / 10.0f);
+
+        for (int i = 0; i < numValues; ++i) {
+            dest[i] = 3.010299957f * log2(jmax(src[i], minimumPower));
+        }
+    }
+}
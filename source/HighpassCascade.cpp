@@ -0,0 +1,192 @@
+#include "HighpassCascade.h"
+#include "FastMath.h"
+
+template <typename SampleType>
+HighpassCascade<SampleType>::HighpassCascade()
+{
+    // Same Butterworth damping as the default StateVariableTPTFilter resonance
+    const auto resonance = static_cast<SampleType>(1.0 / std::sqrt(2.0));
+    R2 = static_cast<SampleType>(1.0 / resonance);
+
+    updateCoefficients();
+}
+
+template <typename SampleType>
+void HighpassCascade<SampleType>::prepare(const dsp::ProcessSpec& spec)
+{
+    jassert(spec.sampleRate > 0);
+    jassert(spec.numChannels > 0);
+
+    sampleRate = spec.sampleRate;
+    numChannels = (int)spec.numChannels;
+    numGroups = (numChannels + numLanes - 1) / numLanes;
+    maxBlockSize = (size_t)spec.maximumBlockSize;
+
+    s1.resize((size_t)(numGroups * numStages));
+    s2.resize((size_t)(numGroups * numStages));
+    interleaved.resize(maxBlockSize);
+
+    updateCoefficients();
+    reset();
+}
+
+template <typename SampleType>
+void HighpassCascade<SampleType>::reset()
+{
+    std::fill(s1.begin(), s1.end(), Vector::expand(0));
+    std::fill(s2.begin(), s2.end(), Vector::expand(0));
+}
+
+template <typename SampleType>
+void HighpassCascade<SampleType>::setCutoffFrequency(float newCutoffFrequency)
+{
+    jassert(isPositiveAndBelow(newCutoffFrequency, static_cast<float>(sampleRate * 0.5)));
+
+    if (newCutoffFrequency == cutoffFrequency) {
+        return;
+    }
+
+    cutoffFrequency = newCutoffFrequency;
+    updateCoefficients();
+}
+
+template <typename SampleType>
+void HighpassCascade<SampleType>::process(const dsp::AudioBlock<SampleType>& block)
+{
+    processGroups<false>(block, 0, 0);
+}
+
+template <typename SampleType>
+void HighpassCascade<SampleType>::process(const dsp::AudioBlock<SampleType>& block, float endCutoffFrequency)
+{
+    jassert(isPositiveAndBelow(endCutoffFrequency, static_cast<float>(sampleRate * 0.5)));
+
+    if (block.getNumSamples() == 0) {
+        return;
+    }
+
+    const auto endG = static_cast<SampleType>(FastMath::tan(MathConstants<float>::pi * endCutoffFrequency / static_cast<float>(sampleRate)));
+    const auto endH = SampleType(1) / (SampleType(1) + R2 * endG + endG * endG);
+    const auto stepScale = SampleType(1) / static_cast<SampleType>(block.getNumSamples());
+
+    processGroups<true>(block, (endG - g) * stepScale, (endH - h) * stepScale);
+
+    cutoffFrequency = endCutoffFrequency;
+    g = endG;
+    h = endH;
+}
+
+template <typename SampleType>
+template <bool ramping>
+void HighpassCascade<SampleType>::processGroups(const dsp::AudioBlock<SampleType>& block, SampleType gStep, SampleType hStep)
+{
+    const auto numSamples = block.getNumSamples();
+    const auto numBlockChannels = jmin((int)block.getNumChannels(), numChannels);
+
+    jassert(numSamples <= maxBlockSize);
+
+    auto gVector = Vector::expand(g);
+    auto hVector = Vector::expand(h);
+    auto feedbackVector = Vector::expand(g + R2);
+
+    auto* interleavedSamples = reinterpret_cast<SampleType*>(interleaved.data());
+
+    for (int group = 0; group < numGroups; ++group) {
+        const auto firstChannel = group * numLanes;
+        const auto numGroupChannels = jmin(numLanes, numBlockChannels - firstChannel);
+
+        if (numGroupChannels <= 0) {
+            break;
+        }
+
+        // Interleave the channels of this group into the lanes
+        if (numGroupChannels < numLanes) {
+            std::fill(interleaved.begin(), interleaved.begin() + (std::ptrdiff_t)numSamples, Vector::expand(0));
+        }
+
+        for (int lane = 0; lane < numGroupChannels; ++lane) {
+            const auto* channelSamples = block.getChannelPointer((size_t)(firstChannel + lane));
+
+            for (size_t i = 0; i < numSamples; ++i) {
+                interleavedSamples[i * numLanes + (size_t)lane] = channelSamples[i];
+            }
+        }
+
+        // Keep the state of all stages in registers while running the block
+        Vector stageS1[numStages];
+        Vector stageS2[numStages];
+
+        for (int stage = 0; stage < numStages; ++stage) {
+            stageS1[stage] = s1[(size_t)(group * numStages + stage)];
+            stageS2[stage] = s2[(size_t)(group * numStages + stage)];
+        }
+
+        // Every group ramps from the same start coefficients
+        auto gValue = g;
+        auto hValue = h;
+
+        for (size_t i = 0; i < numSamples; ++i) {
+            auto sample = interleaved[i];
+
+            if (ramping) {
+                gValue += gStep;
+                hValue += hStep;
+                gVector = Vector::expand(gValue);
+                hVector = Vector::expand(hValue);
+                feedbackVector = Vector::expand(gValue + R2);
+            }
+
+            for (int stage = 0; stage < numStages; ++stage) {
+                const auto yHP = hVector * (sample - stageS1[stage] * feedbackVector - stageS2[stage]);
+
+                const auto yBP = yHP * gVector + stageS1[stage];
+                stageS1[stage] = yHP * gVector + yBP;
+
+                const auto yLP = yBP * gVector + stageS2[stage];
+                stageS2[stage] = yBP * gVector + yLP;
+
+                sample = yHP;
+            }
+
+            interleaved[i] = sample;
+        }
+
+        for (int stage = 0; stage < numStages; ++stage) {
+            s1[(size_t)(group * numStages + stage)] = stageS1[stage];
+            s2[(size_t)(group * numStages + stage)] = stageS2[stage];
+        }
+
+        // Write the lanes back to the channels
+        for (int lane = 0; lane < numGroupChannels; ++lane) {
+            auto* channelSamples = block.getChannelPointer((size_t)(firstChannel + lane));
+
+            for (size_t i = 0; i < numSamples; ++i) {
+                channelSamples[i] = interleavedSamples[i * numLanes + (size_t)lane];
+            }
+        }
+    }
+}
+
+template <typename SampleType>
+void HighpassCascade<SampleType>::snapToZero()
+{
+   #if JUCE_DSP_ENABLE_SNAP_TO_ZERO
+    for (auto* state : { &s1, &s2 }) {
+        auto* values = reinterpret_cast<SampleType*>(state->data());
+
+        for (size_t i = 0; i < state->size() * (size_t)numLanes; ++i) {
+            JUCE_SNAP_TO_ZERO(values[i]);
+        }
+    }
+   #endif
+}
+
+template <typename SampleType>
+void HighpassCascade<SampleType>::updateCoefficients()
+{
+    g = static_cast<SampleType>(std::tan(MathConstants<double>::pi * cutoffFrequency / sampleRate));
+    h = static_cast<SampleType>(1.0 / (1.0 + R2 * g + g * g));
+}
+
+template class HighpassCascade<float>;
+template class HighpassCascade<double>;
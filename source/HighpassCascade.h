@@ -0,0 +1,61 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Cascade of identical TPT state variable highpass stages, equivalent to a
+// chain of dsp::StateVariableTPTFilter objects. The state of every stage is
+// kept in structure-of-arrays form with one SIMD lane per channel, so a
+// whole register of channels is filtered with the same instructions.
+template <typename SampleType>
+class HighpassCascade
+{
+public:
+    using Vector = dsp::SIMDRegister<SampleType>;
+
+    constexpr static int numStages = 4;
+
+    HighpassCascade();
+
+    void prepare(const dsp::ProcessSpec&);
+    void reset();
+
+    void setCutoffFrequency(float);
+
+    // Filters the block in place, it must not be longer than the prepared block size
+    void process(const dsp::AudioBlock<SampleType>&);
+
+    // Filters the block in place while the coefficients move linearly to the
+    // given cutoff, for modulation. The end coefficients use FastMath::tan.
+    void process(const dsp::AudioBlock<SampleType>&, float);
+
+    // Flushes tiny state values to zero, call once at the end of each block
+    void snapToZero();
+
+private:
+    void updateCoefficients();
+
+    template <bool ramping>
+    void processGroups(const dsp::AudioBlock<SampleType>&, SampleType, SampleType);
+
+    constexpr static int numLanes = (int)Vector::SIMDNumElements;
+
+    double sampleRate = 44100.0;
+    float cutoffFrequency = 1000.0f;
+
+    SampleType g = 0;
+    SampleType h = 0;
+    SampleType R2 = 0;
+
+    int numChannels = 0;
+    int numGroups = 0;
+    size_t maxBlockSize = 0;
+
+    // s1 and s2 of every stage, for each group of channels
+    std::vector<Vector> s1;
+    std::vector<Vector> s2;
+
+    // Interleaved samples of one channel group, one lane per channel
+    std::vector<Vector> interleaved;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (HighpassCascade)
+};
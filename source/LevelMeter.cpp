@@ -17,105 +17,48 @@ LevelMeter::~LevelMeter()
 
 void LevelMeter::paint (Graphics& g)
 {
-    // Fill the background
-    g.setColour(Colour(0x18, 0x17, 0x1D));
-    g.fillRoundedRectangle(backgroundRect, cornerSize);
+    TRACE_SCOPE("LevelMeter::paint");
 
-    // Draw grid lines for dB
-    for (int i = mindB + 12; i < maxdB; i += 12) {
-        float y = jmap<float>(i, mindB, maxdB, backgroundRect.getBottom(), backgroundRect.getY());
+    // The static layers follow the scale of the display the editor is on
+    const auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
 
-        if (i == 0) {
-            g.setColour(Colour::fromRGBA(0xFF, 0xFF, 0xFF, 0x40));
-        }
-        else {
-            g.setColour(Colour::fromRGBA(0xFF, 0xFF, 0xFF, 0x10));
-        }
-        g.drawLine(backgroundRect.getX(), y,backgroundRect.getRight(), y, 0.5 * strokeThickness);
+    if (scale != layerScale) {
+        layerScale = scale;
+        renderLayers();
+        renderHistory();
     }
 
+    // Draw background and grid lines
+    backgroundLayer.draw(g);
+
     // Clip the component
-    Path clipRegion;
-    clipRegion.addRoundedRectangle(backgroundRect, cornerSize);
     g.saveState();
     g.reduceClipRegion(clipRegion);
 
-    // Get dry rms path
-    Path dryRmsPath;
-
-    for (size_t i = 0; i < dryRmsValues.size() - 1; i++) {
-        float x = jmap<float>(i, 0, dryRmsValues.size() - 1, backgroundRect.getX(), backgroundRect.getRight());
-        float y = jmap<float>(dryRmsValues[i], mindB, maxdB, backgroundRect.getBottom(), backgroundRect.getY());
-
-        if (i == 0) {
-            dryRmsPath.startNewSubPath(x, y);
-        }
-        else {
-            dryRmsPath.lineTo(x, y);
-        }
-    }
-
-    // Draw dry rms outline
-    g.setColour(Colour(0xFF, 0xFF, 0xFF));
-    g.strokePath(dryRmsPath, PathStrokeType(strokeThickness / 2.0f));
-
-    // Close dry rms path
-    dryRmsPath.lineTo(backgroundRect.getRight(), backgroundRect.getBottom());
-    dryRmsPath.lineTo(backgroundRect.getX(), backgroundRect.getBottom());
-    dryRmsPath.closeSubPath();
+    bool bypass = processorRef.apvts.getRawParameterValue("bypass")->load() > 0.5f;
 
-    // Fill dry rms path
-    g.setColour(Colour::fromRGBA(0x55, 0x55, 0x55, 0x88));
-    g.fillPath(dryRmsPath);
+    // Draw the history, the images wrap around at the newest column
+    if (dryHistoryImage.isValid()) {
+        const auto width = (float)dryHistoryImage.getWidth();
+        const auto newestX = (float)newestColumn * columnWidth;
 
-    bool bypass = processorRef.apvts.getRawParameterValue("bypass")->load() > 0.5f;
+        g.setImageResamplingQuality(Graphics::lowResamplingQuality);
 
-    if (!bypass) {
-        // Get wet rms path
-        Path wetRmsPath;
+        for (auto offset : { width - newestX, -newestX }) {
+            const auto transform = AffineTransform::translation(offset, 0.0f)
+                                       .scaled(1.0f / layerScale)
+                                       .translated(backgroundRect.getX(), backgroundRect.getY());
 
-        for (size_t i = 0; i < wetRmsValues.size() - 1; i++) {
-            float x = jmap<float>(i, 0, wetRmsValues.size() - 1, backgroundRect.getX(), backgroundRect.getRight());
-            float y = jmap<float>(wetRmsValues[i], mindB, maxdB, backgroundRect.getBottom(), backgroundRect.getY());
+            g.drawImageTransformed(dryHistoryImage, transform);
 
-            if (i == 0) {
-                wetRmsPath.startNewSubPath(x, y);
-            }
-            else {
-                wetRmsPath.lineTo(x, y);
+            if (!bypass) {
+                g.drawImageTransformed(wetHistoryImage, transform);
             }
         }
-
-        // Draw wet rms outline
-        g.setColour(Colour(0xFF, 0xFF, 0xFF));
-        g.strokePath(wetRmsPath, PathStrokeType(strokeThickness / 2.0f));
-
-        // Close wet rms path
-        wetRmsPath.lineTo(backgroundRect.getRight(), backgroundRect.getBottom());
-        wetRmsPath.lineTo(backgroundRect.getX(), backgroundRect.getBottom());
-        wetRmsPath.closeSubPath();
-
-        // Fill wet rms path with gradient
-        g.setGradientFill(levelGradient);
-        g.fillPath(wetRmsPath);
     }
 
-    // Draw dB labels
-    for (int i = mindB + 12; i < maxdB; i += 12) {
-        float y = jmap<float>(i, mindB, maxdB, backgroundRect.getBottom(), backgroundRect.getY());
-
-        String text = String(i) + " dB";
-        g.setColour(Colour(0xFF, 0xFF, 0xFF));
-        g.setFont(10.0f);
-        g.drawFittedText(text, Rectangle<int>(backgroundRect.getX(), y - 10, 50, 20), Justification::right, 1);
-    }
-
-    // Draw shadow and light for frame
-    Path frame;
-    PathStrokeType strokeType(5.0f * strokeThickness);
-    strokeType.createStrokedPath(frame, clipRegion);
-    shadow.drawForPath(g, frame);
-    light.drawForPath(g, frame);
+    // Draw dB labels and the shadow and light for frame
+    overlayLayer.draw(g);
 
     // Draw threshold level bar
     float y = jmap<float>(processorRef.apvts.getRawParameterValue("threshold")->load(), mindB, maxdB, backgroundRect.getBottom(), backgroundRect.getY());
@@ -124,9 +67,34 @@ void LevelMeter::paint (Graphics& g)
     g.setGradientFill(juce::ColourGradient(radialGradient));
     g.drawLine(backgroundRect.getX(), y, backgroundRect.getRight(), y, strokeThickness);
 
+    // Draw peak hold markers at the right edge, inside the frame
+    const auto markerRight = backgroundRect.getRight() - 2.5f * strokeThickness;
+    const auto markerLeft = markerRight - peakMarkerWidth;
+
+    float dryPeakY = jmap<float>(dryPeakHold.level, mindB, maxdB, backgroundRect.getBottom(), backgroundRect.getY());
+    g.setColour(Colour::fromRGBA(0xFF, 0xFF, 0xFF, 0x88));
+    g.drawLine(markerLeft, dryPeakY, markerRight, dryPeakY, strokeThickness);
+
+    if (!bypass) {
+        float wetPeakY = jmap<float>(wetPeakHold.level, mindB, maxdB, backgroundRect.getBottom(), backgroundRect.getY());
+        g.setColour(Colour::fromRGBA(0xE4, 0x67, 0x2F, 0xFF));
+        g.drawLine(markerLeft, wetPeakY, markerRight, wetPeakY, strokeThickness);
+
+        // Draw gain reduction hanging down from 0 dB
+        float zeroY = jmap<float>(0.0f, mindB, maxdB, backgroundRect.getBottom(), backgroundRect.getY());
+        float reductionHeight = gainReduction * backgroundRect.getHeight() / (maxdB - mindB);
+        g.setColour(Colour::fromRGBA(0xE4, 0x67, 0x2F, 0xAA));
+        g.fillRect(markerRight - 2.0f * strokeThickness, zeroY, 2.0f * strokeThickness, reductionHeight);
+    }
+
+    if (idle) {
+        g.setColour(Colour::fromRGBA(0xFF, 0xFF, 0xFF, 0x66));
+        g.setFont(10.0f);
+        g.drawFittedText("Idle", backgroundRect.reduced(5.0f * strokeThickness).toNearestInt(), Justification::topRight, 1);
+    }
+
     // Draw frame
-    g.setColour(Colour(0x18, 0x17, 0x1D));
-    g.fillPath(frame);
+    frameLayer.draw(g);
 
     g.restoreState();
 }
@@ -135,22 +103,208 @@ void LevelMeter::resized()
 {
     backgroundRect = getLocalBounds().toFloat();
 
-    float y = jmap<float>(0.0f, mindB, maxdB, backgroundRect.getBottom(), backgroundRect.getY());
-    levelGradient = ColourGradient(Colour::fromRGBA(0xFF, 0xF0, 0x44, 0xAA), backgroundRect.getX(), backgroundRect.getBottom(), Colour::fromRGBA(0xE4, 0x67, 0x2F, 0xAA), backgroundRect.getX(), y, false);
-
     shadow = DropShadow(Colour::fromRGBA(0x00, 0x00, 0x00, 0x44), 5, Point<int>(5, 5));
     light = DropShadow(Colour::fromRGBA(0x48, 0x47, 0x4D, 0x20), 5, Point<int>(-5, -5));
 
     radialGradient = ColourGradient(Colour::fromRGBA(0xFF, 0xFF, 0xFF, 0x00), backgroundRect.getX(), 0.0f, Colour::fromRGBA(0xFF, 0xFF, 0xFF, 0x00), backgroundRect.getRight(), 0.0f, false);
     radialGradient.addColour(0.5f, Colour::fromRGBA(0xFF, 0xFF, 0xFF, 0xFF));
+
+    // The clip region and the frame only change with the bounds
+    clipRegion.clear();
+    clipRegion.addRoundedRectangle(backgroundRect, cornerSize);
+    frame.clear();
+    PathStrokeType(5.0f * strokeThickness).createStrokedPath(frame, clipRegion);
+
+    layerScale = Component::getApproximateScaleFactorForComponent(this);
+    renderLayers();
+    renderHistory();
+}
+
+void LevelMeter::renderLayers()
+{
+    const auto area = getLocalBounds();
+
+    backgroundLayer.render(area, layerScale, [this](Graphics& g) {
+        // Fill the background
+        g.setColour(Colour(0x18, 0x17, 0x1D));
+        g.fillRoundedRectangle(backgroundRect, cornerSize);
+
+        // Draw grid lines for dB
+        for (int i = mindB + 12; i < maxdB; i += 12) {
+            float y = jmap<float>(i, mindB, maxdB, backgroundRect.getBottom(), backgroundRect.getY());
+
+            if (i == 0) {
+                g.setColour(Colour::fromRGBA(0xFF, 0xFF, 0xFF, 0x40));
+            }
+            else {
+                g.setColour(Colour::fromRGBA(0xFF, 0xFF, 0xFF, 0x10));
+            }
+            g.drawLine(backgroundRect.getX(), y, backgroundRect.getRight(), y, 0.5 * strokeThickness);
+        }
+    });
+
+    overlayLayer.render(area, layerScale, [this](Graphics& g) {
+        g.reduceClipRegion(clipRegion);
+
+        // Draw dB labels
+        for (int i = mindB + 12; i < maxdB; i += 12) {
+            float y = jmap<float>(i, mindB, maxdB, backgroundRect.getBottom(), backgroundRect.getY());
+
+            String text = String(i) + " dB";
+            g.setColour(Colour(0xFF, 0xFF, 0xFF));
+            g.setFont(10.0f);
+            g.drawFittedText(text, Rectangle<int>(backgroundRect.getX(), y - 10, 50, 20), Justification::right, 1);
+        }
+
+        // Draw shadow and light for frame
+        shadow.drawForPath(g, frame);
+        light.drawForPath(g, frame);
+    });
+
+    frameLayer.render(area, layerScale, [this](Graphics& g) {
+        g.reduceClipRegion(clipRegion);
+        g.setColour(Colour(0x18, 0x17, 0x1D));
+        g.fillPath(frame);
+    });
 }
 
 void LevelMeter::fillRmsValues(float newDryRmsValue, float newWetRmsValue) {
-    std::rotate(dryRmsValues.begin(), dryRmsValues.begin() + 1, dryRmsValues.end());
-    dryRmsValues.back() = newDryRmsValue;
+    dryRmsValues[writeIndex] = newDryRmsValue;
+    wetRmsValues[writeIndex] = newWetRmsValue;
+    writeIndex = (writeIndex + 1) % bufferSize;
+
+    // The images scroll by one column, only the newest segments are drawn again
+    newestColumn = (newestColumn + 1) % (bufferSize - 1);
+    renderHistory(2);
+
+    repaint();
+}
+
+void LevelMeter::setPeakLevels(float dryPeak, float wetPeak, float newGainReduction)
+{
+    const auto now = Time::getMillisecondCounterHiRes() * 0.001;
 
-    std::rotate(wetRmsValues.begin(), wetRmsValues.begin() + 1, wetRmsValues.end());
-    wetRmsValues.back() = newWetRmsValue;
+    dryPeakHold.update(jlimit(mindB, maxdB, dryPeak), now);
+    wetPeakHold.update(jlimit(mindB, maxdB, wetPeak), now);
+    gainReduction = jlimit(0.0f, maxdB - mindB, newGainReduction);
 
     repaint();
 }
+
+void LevelMeter::setIdle(bool shouldShowIdle)
+{
+    if (shouldShowIdle != idle) {
+        idle = shouldShowIdle;
+        repaint();
+    }
+}
+
+void LevelMeter::PeakHold::update(float peak, double now)
+{
+    if (peak >= level) {
+        level = peak;
+        holdEnd = now + peakHoldTime;
+    }
+    else if (now > holdEnd) {
+        level = jmax(peak, level - peakFallRate * (float)(now - lastUpdate));
+    }
+
+    lastUpdate = now;
+}
+
+void LevelMeter::renderHistory()
+{
+    const auto width = roundToInt(backgroundRect.getWidth() * layerScale);
+    const auto height = roundToInt(backgroundRect.getHeight() * layerScale);
+
+    if (width <= 0 || height <= 0) {
+        dryHistoryImage = {};
+        wetHistoryImage = {};
+        return;
+    }
+
+    // One image pixel per physical pixel, the history spans the whole width
+    dryHistoryImage = Image(Image::ARGB, width, height, true);
+    wetHistoryImage = Image(Image::ARGB, width, height, true);
+    columnWidth = (float)width / (float)(bufferSize - 1);
+
+    renderHistory(bufferSize - 1);
+}
+
+void LevelMeter::renderHistory(int numSegments)
+{
+    if (!dryHistoryImage.isValid()) {
+        return;
+    }
+
+    const auto width = dryHistoryImage.getWidth();
+    const auto height = dryHistoryImage.getHeight();
+
+    // The segments end at the newest column and may wrap around the left edge
+    const auto regionEnd = (float)newestColumn * columnWidth;
+    const auto regionStart = regionEnd - (float)numSegments * columnWidth;
+
+    const auto levelTop = jmap<float>(0.0f, mindB, maxdB, (float)height, 0.0f);
+    const FillType dryFill(Colour::fromRGBA(0x55, 0x55, 0x55, 0x88));
+    const FillType wetFill(ColourGradient(Colour::fromRGBA(0xFF, 0xF0, 0x44, 0xAA), 0.0f, (float)height, Colour::fromRGBA(0xE4, 0x67, 0x2F, 0xAA), 0.0f, levelTop, false));
+
+    for (auto offset : { 0, width }) {
+        const auto columns = Rectangle<int>::leftTopRightBottom((int)std::floor(regionStart) + offset, 0, (int)std::ceil(regionEnd) + offset, height)
+                                 .getIntersection({ width, height });
+
+        if (columns.isEmpty()) {
+            continue;
+        }
+
+        dryHistoryImage.clear(columns);
+        wetHistoryImage.clear(columns);
+
+        Graphics dryGraphics(dryHistoryImage);
+        dryGraphics.reduceClipRegion(columns);
+        drawHistory(dryGraphics, dryRmsValues, numSegments, (float)offset, dryFill);
+
+        Graphics wetGraphics(wetHistoryImage);
+        wetGraphics.reduceClipRegion(columns);
+        drawHistory(wetGraphics, wetRmsValues, numSegments, (float)offset, wetFill);
+    }
+}
+
+void LevelMeter::drawHistory(Graphics& g, const std::vector<float>& values, int numSegments, float offset, const FillType& fill) const
+{
+    // The clip always spans the whole height of the image
+    const auto height = (float)g.getClipBounds().getBottom();
+
+    // One older point than the segments, so the joins match the previous segments
+    const auto oldestAge = jmin(numSegments + 1, bufferSize - 1);
+    Path rmsPath;
+
+    for (int age = oldestAge; age >= 0; --age) {
+        float x = offset + (float)(newestColumn - age) * columnWidth;
+        float y = jmap<float>(getHistoryValue(values, age), mindB, maxdB, height, 0.0f);
+
+        if (age == oldestAge) {
+            rmsPath.startNewSubPath(x, y);
+        }
+        else {
+            rmsPath.lineTo(x, y);
+        }
+    }
+
+    // Draw rms outline
+    g.setColour(Colour(0xFF, 0xFF, 0xFF));
+    g.strokePath(rmsPath, PathStrokeType(layerScale * strokeThickness / 2.0f));
+
+    // Close rms path
+    rmsPath.lineTo(offset + (float)newestColumn * columnWidth, height);
+    rmsPath.lineTo(offset + (float)(newestColumn - oldestAge) * columnWidth, height);
+    rmsPath.closeSubPath();
+
+    // Fill rms path
+    g.setFillType(fill);
+    g.fillPath(rmsPath);
+}
+
+float LevelMeter::getHistoryValue(const std::vector<float>& values, int age) const
+{
+    return values[(writeIndex + (size_t)(bufferSize - 1 - age)) % bufferSize];
+}
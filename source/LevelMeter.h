@@ -1,6 +1,7 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "CachedLayer.h"
 #include "PluginProcessor.h"
 
 class LevelMeter  : public Component
@@ -14,23 +15,75 @@ public:
 
     void fillRmsValues(float, float);
 
+    // Peaks of the latest frame in dB and the largest gain reduction in dB
+    void setPeakLevels(float, float, float);
+
+    // Shown while the processor skips its chain on silent input
+    void setIdle(bool);
+
     constexpr static float mindB = -60.0f;
     constexpr static float maxdB = 36.0f;
     constexpr static int bufferSize = 256;
 
 
 private:
+    // Renders the parts that do not change between frames
+    void renderLayers();
+
+    // Renders the whole history, or only the newest segments of it
+    void renderHistory();
+    void renderHistory(int);
+    void drawHistory(Graphics&, const std::vector<float>&, int, float, const FillType&) const;
+    float getHistoryValue(const std::vector<float>&, int) const;
+
     Processor& processorRef;
 
     Rectangle<float> backgroundRect;
+    Path clipRegion;
+    Path frame;
+
+    // Background with the grid, the labels with the frame shadows, and the
+    // frame on top. Only the levels and the threshold are drawn every frame.
+    CachedLayer backgroundLayer;
+    CachedLayer overlayLayer;
+    CachedLayer frameLayer;
+    float layerScale = 1.0f;
 
-    ColourGradient levelGradient;
     ColourGradient radialGradient;
     DropShadow shadow;
     DropShadow light;
 
+    // Ring buffers of the history, the newest value sits before writeIndex
     std::vector<float> dryRmsValues;
     std::vector<float> wetRmsValues;
+    size_t writeIndex = 0;
+
+    // Peak markers hold the highest peak for a while and then fall
+    struct PeakHold
+    {
+        float level = mindB;
+        double holdEnd = 0.0;
+        double lastUpdate = 0.0;
+
+        void update(float, double);
+    };
+
+    PeakHold dryPeakHold;
+    PeakHold wetPeakHold;
+    float gainReduction = 0.0f;
+    bool idle = false;
+
+    constexpr static double peakHoldTime = 1.5;
+    constexpr static float peakFallRate = 20.0f;
+    constexpr static float peakMarkerWidth = 16.0f;
+
+    // The history curves are drawn into images that wrap around horizontally,
+    // so a new value only rasterises its own segment. paint blits each image
+    // in two parts, which puts the newest column on the right edge.
+    Image dryHistoryImage;
+    Image wetHistoryImage;
+    int newestColumn = 0;
+    float columnWidth = 0.0f;
 
     constexpr static float cornerSize = 10.0f;
     constexpr static float strokeThickness = 2.0f;
@@ -0,0 +1,246 @@
+#include "LinearPhaseHighpass.h"
+
+namespace
+{
+    void copySamples(float* dest, const float* src, int numSamples)
+    {
+        FloatVectorOperations::copy(dest, src, numSamples);
+    }
+
+    template <typename Dest, typename Src>
+    void copySamples(Dest* dest, const Src* src, int numSamples)
+    {
+        for (int i = 0; i < numSamples; ++i) {
+            dest[i] = static_cast<Dest>(src[i]);
+        }
+    }
+}
+
+LinearPhaseHighpass::LinearPhaseHighpass()
+    : Thread("Linear phase highpass design")
+    , partitionFFT(roundToInt(std::log2(fftSize)))
+    , designFFT(roundToInt(std::log2(kernelLength)))
+    , designPartitionFFT(roundToInt(std::log2(fftSize)))
+{
+}
+
+LinearPhaseHighpass::~LinearPhaseHighpass()
+{
+    stopThread(1000);
+}
+
+void LinearPhaseHighpass::prepare(const dsp::ProcessSpec& spec)
+{
+    jassert(spec.sampleRate > 0);
+    jassert(spec.numChannels > 0);
+
+    stopThread(1000);
+
+    numChannels = (size_t)spec.numChannels;
+
+    frames.resize(numChannels * fftSize);
+    spectra.resize(numChannels * numPartitions * spectrumSize);
+    outputs.resize(numChannels * partitionSize);
+    fftBuffer.resize(2 * fftSize);
+    crossfadeBuffer.resize(partitionSize);
+
+    designBuffer.resize(2 * kernelLength);
+    designPartitionBuffer.resize(2 * fftSize);
+    kernelSlots.resize(numKernelSlots * numPartitions * spectrumSize);
+
+    // Design the first kernel here, so processing starts with the right one
+    frontSlot = 0;
+    backSlot = 1;
+    middleSlot.store(2);
+
+    targetSampleRate.store(spec.sampleRate);
+    designedCutoff = targetCutoff.load();
+    designedSampleRate = spec.sampleRate;
+    design(getKernel(frontSlot), designedCutoff, designedSampleRate);
+
+    reset();
+
+    startThread(Thread::Priority::low);
+}
+
+void LinearPhaseHighpass::reset()
+{
+    std::fill(frames.begin(), frames.end(), 0.0f);
+    std::fill(spectra.begin(), spectra.end(), 0.0f);
+    std::fill(outputs.begin(), outputs.end(), 0.0f);
+    fifoPosition = 0;
+    spectrumPosition = 0;
+}
+
+void LinearPhaseHighpass::setCutoffFrequency(float newCutoffFrequency)
+{
+    targetCutoff.store(newCutoffFrequency, std::memory_order_relaxed);
+}
+
+void LinearPhaseHighpass::setSampleRate(double newSampleRate)
+{
+    targetSampleRate.store(newSampleRate, std::memory_order_relaxed);
+}
+
+void LinearPhaseHighpass::setActive(bool shouldBeActive)
+{
+    if (active.exchange(shouldBeActive) != shouldBeActive && shouldBeActive) {
+        notify();
+    }
+}
+
+template <typename SampleType>
+void LinearPhaseHighpass::process(const dsp::AudioBlock<SampleType>& block)
+{
+    const auto numSamples = (int)block.getNumSamples();
+    const auto numBlockChannels = block.getNumChannels();
+
+    jassert(numBlockChannels <= numChannels);
+
+    // Collect the input into the second half of each frame and hand out the
+    // output of the previous partition
+    for (int startSample = 0; startSample < numSamples;) {
+        const auto length = jmin(numSamples - startSample, partitionSize - fifoPosition);
+
+        for (size_t channel = 0; channel < numBlockChannels; ++channel) {
+            auto* samples = block.getChannelPointer(channel) + startSample;
+
+            copySamples(frames.data() + channel * fftSize + partitionSize + fifoPosition, samples, length);
+            copySamples(samples, outputs.data() + channel * partitionSize + fifoPosition, length);
+        }
+
+        startSample += length;
+        fifoPosition += length;
+
+        if (fifoPosition == partitionSize) {
+            processPartition();
+            fifoPosition = 0;
+        }
+    }
+}
+
+void LinearPhaseHighpass::processPartition()
+{
+    // The newest input spectrum goes in front of the older ones
+    spectrumPosition = (spectrumPosition + numPartitions - 1) % numPartitions;
+
+    for (size_t channel = 0; channel < numChannels; ++channel) {
+        auto* frame = frames.data() + channel * fftSize;
+
+        FloatVectorOperations::copy(fftBuffer.data(), frame, fftSize);
+        partitionFFT.performRealOnlyForwardTransform(fftBuffer.data(), true);
+        FloatVectorOperations::copy(spectra.data() + (channel * numPartitions + (size_t)spectrumPosition) * spectrumSize, fftBuffer.data(), spectrumSize);
+
+        // The second half overlaps with the next frame
+        FloatVectorOperations::copy(frame, frame + partitionSize, partitionSize);
+
+        convolve(channel, getKernel(frontSlot), outputs.data() + channel * partitionSize);
+    }
+
+    // Swap in a new kernel only after the old one has been used, so the
+    // designer never writes into a kernel that is still being read
+    if ((middleSlot.load(std::memory_order_acquire) & freshFlag) == 0) {
+        return;
+    }
+
+    frontSlot = middleSlot.exchange(frontSlot, std::memory_order_acq_rel) & slotMask;
+
+    for (size_t channel = 0; channel < numChannels; ++channel) {
+        auto* output = outputs.data() + channel * partitionSize;
+        convolve(channel, getKernel(frontSlot), crossfadeBuffer.data());
+
+        for (int i = 0; i < partitionSize; ++i) {
+            const auto fade = (float)(i + 1) / (float)partitionSize;
+            output[i] += fade * (crossfadeBuffer[(size_t)i] - output[i]);
+        }
+    }
+}
+
+void LinearPhaseHighpass::convolve(size_t channel, const float* kernel, float* output)
+{
+    auto* accumulator = fftBuffer.data();
+    std::fill(fftBuffer.begin(), fftBuffer.end(), 0.0f);
+
+    // Multiply every input spectrum with the kernel partition of its age
+    for (int partition = 0; partition < numPartitions; ++partition) {
+        const auto age = (size_t)((spectrumPosition + partition) % numPartitions);
+        const auto* input = spectra.data() + (channel * numPartitions + age) * spectrumSize;
+        const auto* coefficients = kernel + (size_t)partition * spectrumSize;
+
+        for (int i = 0; i < spectrumSize; i += 2) {
+            accumulator[i] += input[i] * coefficients[i] - input[i + 1] * coefficients[i + 1];
+            accumulator[i + 1] += input[i] * coefficients[i + 1] + input[i + 1] * coefficients[i];
+        }
+    }
+
+    // Overlap-save keeps the second half, the first one has wrapped around
+    partitionFFT.performRealOnlyInverseTransform(accumulator);
+    FloatVectorOperations::copy(output, accumulator + partitionSize, partitionSize);
+}
+
+float* LinearPhaseHighpass::getKernel(int slot)
+{
+    return kernelSlots.data() + (size_t)slot * numPartitions * spectrumSize;
+}
+
+void LinearPhaseHighpass::run()
+{
+    while (!threadShouldExit()) {
+        // Nothing uses the kernels while inactive, so sleep until switched on
+        if (!active.load()) {
+            wait(-1);
+            continue;
+        }
+
+        const auto cutoff = targetCutoff.load(std::memory_order_relaxed);
+        const auto sampleRate = targetSampleRate.load(std::memory_order_relaxed);
+
+        if (cutoff != designedCutoff || sampleRate != designedSampleRate) {
+            design(getKernel(backSlot), cutoff, sampleRate);
+            designedCutoff = cutoff;
+            designedSampleRate = sampleRate;
+
+            backSlot = middleSlot.exchange(backSlot | freshFlag, std::memory_order_acq_rel) & slotMask;
+        }
+
+        wait(pollIntervalMs);
+    }
+}
+
+void LinearPhaseHighpass::design(float* kernel, float cutoff, double sampleRate)
+{
+    // Magnitude of the TPT cascade, every stage is a bilinear Butterworth
+    // highpass with |H|^2 = 1 / (1 + t) and t = (tan(w_c / 2) / tan(w / 2))^4.
+    // The alternating sign delays the zero-phase response by half the kernel.
+    const auto warpedCutoff = std::tan(MathConstants<double>::pi * (double)cutoff / sampleRate);
+    auto* bins = designBuffer.data();
+
+    for (int bin = 0; bin <= kernelLength / 2; ++bin) {
+        const auto warped = std::tan(MathConstants<double>::pi * (double)bin / (double)kernelLength);
+        const auto t = std::pow(warpedCutoff / jmax(warped, 1.0e-300), 4.0);
+        const auto stageMagnitudeSquared = 1.0 / (1.0 + t);
+
+        bins[2 * bin] = (float)(stageMagnitudeSquared * stageMagnitudeSquared * ((bin & 1) != 0 ? -1.0 : 1.0));
+        bins[2 * bin + 1] = 0.0f;
+    }
+
+    designFFT.performRealOnlyInverseTransform(bins);
+
+    // Blackman window centred on the middle tap keeps the kernel symmetric
+    for (int i = 0; i < kernelLength; ++i) {
+        const auto phase = MathConstants<double>::twoPi * (double)i / (double)kernelLength;
+        bins[i] *= (float)(0.42 - 0.5 * std::cos(phase) + 0.08 * std::cos(2.0 * phase));
+    }
+
+    // Zero-padded spectrum of every partition
+    for (int partition = 0; partition < numPartitions; ++partition) {
+        std::fill(designPartitionBuffer.begin(), designPartitionBuffer.end(), 0.0f);
+        FloatVectorOperations::copy(designPartitionBuffer.data(), bins + partition * partitionSize, partitionSize);
+
+        designPartitionFFT.performRealOnlyForwardTransform(designPartitionBuffer.data(), true);
+        FloatVectorOperations::copy(kernel + (size_t)partition * spectrumSize, designPartitionBuffer.data(), spectrumSize);
+    }
+}
+
+template void LinearPhaseHighpass::process<float>(const dsp::AudioBlock<float>&);
+template void LinearPhaseHighpass::process<double>(const dsp::AudioBlock<double>&);
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Linear-phase counterpart of the HighpassCascade. A background thread
+// designs an FIR with the magnitude response of the cascade whenever the
+// cutoff or the sample rate changes, and the audio thread applies it with
+// uniformly partitioned overlap-save convolution. Finished kernels are handed
+// over through a lock-free triple buffer and crossfaded in over one partition.
+// The designer sleeps while the filter is inactive.
+class LinearPhaseHighpass : private Thread
+{
+public:
+    LinearPhaseHighpass();
+    ~LinearPhaseHighpass() override;
+
+    // Allocates everything and designs the first kernel before returning
+    void prepare(const dsp::ProcessSpec&);
+    void reset();
+
+    // Both only request a new kernel, so they are safe on the audio thread
+    void setCutoffFrequency(float);
+    void setSampleRate(double);
+
+    // Switching on wakes the designer, which then follows the cutoff until
+    // switched off again. Only switch on rarely from the audio thread, waking
+    // the designer takes a lock.
+    void setActive(bool);
+
+    // Filters the block in place, delayed by latencyInSamples. The convolution
+    // runs in float for both precisions, dsp::FFT has no double version.
+    template <typename SampleType>
+    void process(const dsp::AudioBlock<SampleType>&);
+
+    // The kernel length is fixed, so the cost per sample does not grow with
+    // the sample rate. The input is buffered for one partition and the
+    // kernel is centred on half its length.
+    constexpr static int partitionSize = 256;
+    constexpr static int kernelLength = 8192;
+    constexpr static int latencyInSamples = partitionSize + kernelLength / 2;
+
+private:
+    void run() override;
+
+    void design(float*, float, double);
+    void processPartition();
+    void convolve(size_t, const float*, float*);
+    float* getKernel(int);
+
+    constexpr static int numPartitions = kernelLength / partitionSize;
+    constexpr static int fftSize = 2 * partitionSize;
+
+    // Bins 0 to partitionSize of a partition, as interleaved complex values
+    constexpr static int spectrumSize = fftSize + 2;
+
+    // Audio thread
+    dsp::FFT partitionFFT;
+    size_t numChannels = 0;
+    int fifoPosition = 0;
+    int spectrumPosition = 0;
+    std::vector<float> frames;
+    std::vector<float> spectra;
+    std::vector<float> outputs;
+    std::vector<float> fftBuffer;
+    std::vector<float> crossfadeBuffer;
+
+    // Design thread
+    dsp::FFT designFFT;
+    dsp::FFT designPartitionFFT;
+    std::vector<float> designBuffer;
+    std::vector<float> designPartitionBuffer;
+    float designedCutoff = 0.0f;
+    double designedSampleRate = 0.0;
+
+    std::atomic<float> targetCutoff { 1000.0f };
+    std::atomic<double> targetSampleRate { 44100.0 };
+    std::atomic<bool> active { false };
+
+    // The audio thread reads the front kernel, the designer writes the back
+    // one and the middle one is swapped between them, flagged when fresh
+    constexpr static int numKernelSlots = 3;
+    constexpr static int slotMask = 3;
+    constexpr static int freshFlag = 4;
+    std::vector<float> kernelSlots;
+    int frontSlot = 0;
+    int backSlot = 1;
+    std::atomic<int> middleSlot { 2 };
+
+    constexpr static int pollIntervalMs = 10;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LinearPhaseHighpass)
+};
@@ -0,0 +1,79 @@
+#include "LogFrequencyMap.h"
+#include "FastMath.h"
+
+void LogFrequencyMap::prepare(int newNumBins, int scopeSize)
+{
+    jassert(newNumBins > 1 && scopeSize > 0);
+
+    numBins = newNumBins;
+    entries.resize((size_t)scopeSize);
+    scopePowers.resize((size_t)scopeSize);
+
+    const auto lastBinIndex = (float)(numBins - 1);
+
+    auto getBinPosition = [&](float scopePosition) {
+        return jlimit(0.0f, lastBinIndex, getSkewedProportion(scopePosition / (float)scopeSize) * lastBinIndex);
+    };
+
+    for (int i = 0; i < scopeSize; ++i) {
+        auto& entry = entries[(size_t)i];
+        const auto lowerEdge = getBinPosition((float)i - 0.5f);
+        const auto upperEdge = getBinPosition((float)i + 0.5f);
+        const auto centre = getBinPosition((float)i);
+
+        if (upperEdge - lowerEdge < 1.0f) {
+            // Fewer than one bin per point, interpolate between the two nearest bins
+            entry.firstBin = jmin((int)centre, numBins - 2);
+            entry.lastBin = entry.firstBin + 1;
+            entry.fraction = centre - (float)entry.firstBin;
+            entry.interpolate = true;
+        }
+        else {
+            // Several bins per point, aggregate all bins inside the point
+            entry.firstBin = (int)std::ceil(lowerEdge);
+            entry.lastBin = jmax(entry.firstBin, (int)std::floor(upperEdge));
+            entry.fraction = 1.0f / (float)(entry.lastBin - entry.firstBin + 1);
+            entry.interpolate = false;
+        }
+    }
+}
+
+void LogFrequencyMap::setAggregation(Aggregation newAggregation)
+{
+    aggregation = newAggregation;
+}
+
+void LogFrequencyMap::process(const float* binPowers, float* levels)
+{
+    const auto scopeSize = (int)entries.size();
+
+    for (int i = 0; i < scopeSize; ++i) {
+        const auto& entry = entries[(size_t)i];
+        float power;
+
+        if (entry.interpolate) {
+            power = binPowers[entry.firstBin] + entry.fraction * (binPowers[entry.lastBin] - binPowers[entry.firstBin]);
+        }
+        else if (aggregation == Aggregation::maximum) {
+            power = FloatVectorOperations::findMaximum(binPowers + entry.firstBin, entry.lastBin - entry.firstBin + 1);
+        }
+        else {
+            power = 0.0f;
+
+            for (int bin = entry.firstBin; bin <= entry.lastBin; ++bin) {
+                power += binPowers[bin];
+            }
+
+            power *= entry.fraction;
+        }
+
+        scopePowers[(size_t)i] = power;
+    }
+
+    FastMath::powerToDecibels(levels, scopePowers.data(), scopeSize);
+}
+
+float LogFrequencyMap::getSkewedProportion(float scopeProportion)
+{
+    return (std::exp(scopeProportion / 0.164f) - 1.0f) / 443.158f;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Maps a linear FFT power spectrum onto the log-frequency scope of the
+// spectrum analyzer. The bin range and weight of every scope point are built
+// once in prepare, so mapping a frame only costs O(scopeSize + numBins).
+// Sparse low bins are interpolated, dense high bins are aggregated.
+class LogFrequencyMap
+{
+public:
+    enum class Aggregation
+    {
+        maximum,
+        powerAverage
+    };
+
+    // Builds the table for a number of FFT bins and scope points, allocates
+    void prepare(int, int);
+
+    void setAggregation(Aggregation);
+
+    // Writes scopeSize levels in dB for numBins powers, allocation free
+    void process(const float*, float*);
+
+    // Position of a scope point in [0, 1] as a proportion of Nyquist, the same
+    // skew the analyzer grid uses
+    static float getSkewedProportion(float);
+
+private:
+    struct Entry
+    {
+        int firstBin;
+        int lastBin;
+        float fraction;
+        bool interpolate;
+    };
+
+    std::vector<Entry> entries;
+    std::vector<float> scopePowers;
+    Aggregation aggregation = Aggregation::maximum;
+    int numBins = 0;
+};
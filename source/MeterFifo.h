@@ -0,0 +1,73 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "PaddedFifo.h"
+
+// Wait-free single-producer/single-consumer queue of meter readings. The
+// audio thread pushes one reading per processed chunk, so no block goes
+// unmetered, and the editor drains everything that arrived since its last
+// frame. Aligned to a cache line, so it shares none with its neighbours.
+template <int numSlots>
+class alignas(cacheLineSize) MeterFifo
+{
+public:
+    // Levels are linear and taken over all channels together, the gain
+    // reduction is the largest one of the chunk in dB. Idle readings cover
+    // silence the processor did not run its chain on.
+    struct Reading
+    {
+        float dryPeak;
+        float dryRms;
+        float wetPeak;
+        float wetRms;
+        float gainReduction;
+        int numSamples;
+        bool idle;
+    };
+
+    MeterFifo()
+        : fifo(numSlots)
+    {
+    }
+
+    // Called from the audio thread only. Drops the reading if the reader is behind.
+    bool push(const Reading& reading) noexcept
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToWrite(1, start1, size1, start2, size2);
+
+        if (size1 == 0) {
+            return false;
+        }
+
+        slots[(size_t)start1] = reading;
+        fifo.finishedWrite(1);
+        return true;
+    }
+
+    // Called from the reading thread only. Passes every reading to the
+    // callback in the order they were written and returns how many there were.
+    template <typename Callback>
+    int popAll(Callback&& callback)
+    {
+        int start1, size1, start2, size2;
+        fifo.prepareToRead(fifo.getNumReady(), start1, size1, start2, size2);
+
+        for (int i = 0; i < size1; ++i) {
+            callback(slots[(size_t)(start1 + i)]);
+        }
+
+        for (int i = 0; i < size2; ++i) {
+            callback(slots[(size_t)(start2 + i)]);
+        }
+
+        fifo.finishedRead(size1 + size2);
+        return size1 + size2;
+    }
+
+private:
+    PaddedFifo fifo;
+    alignas(cacheLineSize) std::array<Reading, (size_t)numSlots> slots;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MeterFifo)
+};
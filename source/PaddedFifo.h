@@ -0,0 +1,100 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "CacheLine.h"
+
+// The parts of AbstractFifo the queues use, for one producer and one
+// consumer. AbstractFifo keeps both positions next to each other, so the
+// producer and the consumer write the same cache line on every push and pop.
+// Here each side owns a line with its position and a copy of the other
+// side's position, and only reads the other line when its copy says the
+// queue is full or empty.
+class PaddedFifo
+{
+public:
+    explicit PaddedFifo(int capacity) noexcept
+        : bufferSize(capacity)
+    {
+        jassert(capacity > 0);
+    }
+
+    // Called from the producer only
+    void prepareToWrite(int numToWrite, int& startIndex1, int& blockSize1, int& startIndex2, int& blockSize2) noexcept
+    {
+        const auto write = writer.position.load(std::memory_order_relaxed);
+        auto freeSpace = getFreeSpace(write, writer.otherPosition);
+
+        if (freeSpace < numToWrite) {
+            writer.otherPosition = reader.position.load(std::memory_order_acquire);
+            freeSpace = getFreeSpace(write, writer.otherPosition);
+        }
+
+        getBlocks(write, jmin(numToWrite, freeSpace), startIndex1, blockSize1, startIndex2, blockSize2);
+    }
+
+    void finishedWrite(int numWritten) noexcept
+    {
+        const auto write = writer.position.load(std::memory_order_relaxed);
+        writer.position.store((write + numWritten) % bufferSize, std::memory_order_release);
+    }
+
+    // Called from the consumer only
+    int getNumReady() noexcept
+    {
+        reader.otherPosition = writer.position.load(std::memory_order_acquire);
+        return getNumReady(reader.position.load(std::memory_order_relaxed), reader.otherPosition);
+    }
+
+    void prepareToRead(int numWanted, int& startIndex1, int& blockSize1, int& startIndex2, int& blockSize2) noexcept
+    {
+        const auto read = reader.position.load(std::memory_order_relaxed);
+        auto numReady = getNumReady(read, reader.otherPosition);
+
+        if (numReady < numWanted) {
+            reader.otherPosition = writer.position.load(std::memory_order_acquire);
+            numReady = getNumReady(read, reader.otherPosition);
+        }
+
+        getBlocks(read, jmin(numWanted, numReady), startIndex1, blockSize1, startIndex2, blockSize2);
+    }
+
+    void finishedRead(int numRead) noexcept
+    {
+        const auto read = reader.position.load(std::memory_order_relaxed);
+        reader.position.store((read + numRead) % bufferSize, std::memory_order_release);
+    }
+
+private:
+    // One slot stays empty, so a full queue can be told from an empty one
+    int getFreeSpace(int write, int read) const noexcept
+    {
+        return bufferSize - 1 - getNumReady(read, write);
+    }
+
+    int getNumReady(int read, int write) const noexcept
+    {
+        return write >= read ? write - read : bufferSize - read + write;
+    }
+
+    void getBlocks(int start, int num, int& startIndex1, int& blockSize1, int& startIndex2, int& blockSize2) const noexcept
+    {
+        startIndex1 = start;
+        blockSize1 = jmax(0, jmin(num, bufferSize - start));
+        startIndex2 = 0;
+        blockSize2 = jmax(0, num - blockSize1);
+    }
+
+    struct alignas(cacheLineSize) Side
+    {
+        std::atomic<int> position { 0 };
+
+        // Last seen position of the other side, private to this side
+        int otherPosition = 0;
+    };
+
+    const int bufferSize;
+    Side writer;
+    Side reader;
+
+    JUCE_DECLARE_NON_COPYABLE (PaddedFifo)
+};
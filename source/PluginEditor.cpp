@@ -5,25 +5,30 @@
 Editor::Editor (Processor& p)
     : AudioProcessorEditor (&p)
     , processorRef (p)
-    , forwardFFT(processorRef.fftOrder)
-    , window(1 << processorRef.fftOrder, dsp::WindowingFunction<float>::hann)
+    , spectrumEngine(p)
     , levelMeter(p)
     , spectrumAnalyzer(p)
     , shadow(Colour::fromRGBA(0x00, 0x00, 0x00, 0x66), 15, Point<int>(5, 5))
     , light(Colour::fromRGBA(0x48, 0x47, 0x4D, 0x20), 15, Point<int>(-5, -5))
+    , diagnosticsPanel(p)
 {
     setSize (600, 450);
+
+    // Drop whatever is left from a previous editor before enabling the meters
+    processorRef.popMeterReadings([](const Processor::MeterReadings::Reading&) {});
+    processorRef.setMeteringEnabled(true);
+
     startTimerHz(30);
 
     addAndMakeVisible(levelMeter);
     addAndMakeVisible(spectrumAnalyzer);
+    spectrumAnalyzer.addMouseListener(this, false);
 
     // Threshold slider
     thresholdSliderAttachment = std::make_unique<AudioProcessorValueTreeState::SliderAttachment>(processorRef.apvts, "threshold", thresholdSlider);
     thresholdSlider.setSliderStyle(Slider::LinearVertical);
     thresholdSlider.setRange(levelMeter.mindB, levelMeter.maxdB, 0.01f);
     thresholdSlider.setTextBoxStyle(Slider::NoTextBox, false, 0, 0);
-    thresholdSlider.addListener(this);
     thresholdSlider.setLookAndFeel(&lookAndFeel);
     addAndMakeVisible(&thresholdSlider);
     thresholdSlider.setValue(processorRef.apvts.getRawParameterValue("threshold")->load());
@@ -33,7 +38,6 @@ Editor::Editor (Processor& p)
     cutoffSlider.setSliderStyle(Slider::LinearHorizontal);
     cutoffSlider.setRange(spectrumAnalyzer.minHz, spectrumAnalyzer.maxHz, 0.1f);
     cutoffSlider.setTextBoxStyle(Slider::NoTextBox, false, 0, 0);
-    cutoffSlider.addListener(this);
     cutoffSlider.setLookAndFeel(&lookAndFeel);
     addAndMakeVisible(&cutoffSlider);
     cutoffSlider.setValue(processorRef.apvts.getRawParameterValue("cutoff")->load());
@@ -44,14 +48,39 @@ Editor::Editor (Processor& p)
     addAndMakeVisible(&bypassButton);
     bool bypass = processorRef.apvts.getRawParameterValue("bypass")->load() > 0.5f;
     bypassButton.setToggleState(bypass, NotificationType::dontSendNotification);
+
+    // Diagnostics panel
+    diagnosticsPanel.onExpandedChange = [this] { layoutDiagnostics(); };
+    addAndMakeVisible(diagnosticsPanel);
 }
 
 Editor::~Editor()
 {
+    spectrumAnalyzer.removeMouseListener(this);
     stopTimer();
+    processorRef.setMeteringEnabled(false);
 }
 
 void Editor::paint (Graphics& g)
+{
+    // Children repaint the editor under their corners, so the background is only rendered again for a new scale
+    const auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+
+    if (!backgroundLayer.isValid() || scale != backgroundLayer.getScale()) {
+        renderBackground(scale);
+    }
+
+    backgroundLayer.draw(g);
+}
+
+void Editor::renderBackground(float scale)
+{
+    backgroundLayer.render(getLocalBounds(), scale, [this](Graphics& g) {
+        drawBackground(g);
+    });
+}
+
+void Editor::drawBackground(Graphics& g)
 {
     g.setColour(Colour(0x18, 0x17, 0x1D));
     g.fillAll();
@@ -67,8 +96,6 @@ void Editor::paint (Graphics& g)
     light.drawForRectangle(g, levelMeter.getBounds());
     shadow.drawForRectangle(g, spectrumAnalyzer.getBounds());
     light.drawForRectangle(g, spectrumAnalyzer.getBounds());
-
-    bypassButton.repaint();
 }
 
 void Editor::resized()
@@ -91,40 +118,96 @@ void Editor::resized()
     thresholdSlider.setBounds(levelMeterBounds.getX() + 60, levelMeterBounds.getY() + 20, 15, levelMeterBounds.getHeight() - 40);
     cutoffSlider.setBounds(spectrumAnalyserBounds.getCentreX() - spectrumAnalyserBounds.getWidth() / 3.0f, spectrumAnalyserBounds.getBottom() - 60, 2.0f * spectrumAnalyserBounds.getWidth() / 3.0f, 15);
     bypassButton.setBounds(20, 15, 40, 40);
-}
-
-void Editor::timerCallback()
-{
-	// Get the rms value from the audio processor
-    float dryRmsValue = jlimit(levelMeter.mindB, levelMeter.maxdB, processorRef.getRmsValue(true));
-    float wetRmsValue = jlimit(levelMeter.mindB, levelMeter.maxdB, processorRef.getRmsValue(false));
-
-	// add the rms value to the level meter
-	levelMeter.fillRmsValues(dryRmsValue, wetRmsValue);
 
-    // Perform fft
-    window.multiplyWithWindowingTable(processorRef.dryFftData, processorRef.fftSize);
-    forwardFFT.performFrequencyOnlyForwardTransform(processorRef.dryFftData);
-    window.multiplyWithWindowingTable(processorRef.wetFftData, processorRef.fftSize);
-    forwardFFT.performFrequencyOnlyForwardTransform(processorRef.wetFftData);
+    layoutDiagnostics();
 
-    // interpolate fft data
-    dryLagrangeInterpolator.process((float)processorRef.fftSize / (float)interpolatedSize, processorRef.dryFftData, dryInterpolatedFftData, interpolatedSize);
-    wetLagrangeInterpolator.process((float)processorRef.fftSize / (float)interpolatedSize, processorRef.wetFftData, wetInterpolatedFftData, interpolatedSize);
+    renderBackground(Component::getApproximateScaleFactorForComponent(this));
+}
 
-    // Update the spectrum analyzer
-    spectrumAnalyzer.updateSpectra(dryInterpolatedFftData, wetInterpolatedFftData, (float)interpolatedSize);
-    processorRef.nextDryFFTBlockReady = false;
-    processorRef.nextWetFFTBlockReady = false;
+void Editor::layoutDiagnostics()
+{
+    // Collapsed it is a button in the top right corner, expanded it covers the meter and the analyzer
+    if (diagnosticsPanel.isExpanded()) {
+        diagnosticsPanel.setBounds(Rectangle<int>::leftTopRightBottom(70, 13, getWidth() - 20, spectrumAnalyzer.getBottom()));
+    }
+    else {
+        diagnosticsPanel.setBounds(getWidth() - 30 - DiagnosticsPanel::collapsedWidth, 23, DiagnosticsPanel::collapsedWidth, DiagnosticsPanel::collapsedHeight);
+    }
+}
 
-    repaint();
+void Editor::mouseDown(const MouseEvent& event)
+{
+    if (event.eventComponent != &spectrumAnalyzer || !event.mods.isPopupMenu()) {
+        return;
+    }
+
+    PopupMenu menu;
+    menu.addSectionHeader("Analyzer overlap");
+
+    // More overlap follows transients more closely and costs more analysis
+    const std::pair<int, const char*> overlaps[] = {
+        { Processor::fftSize / 2, "50%" },
+        { Processor::fftSize / 4, "75%" },
+        { Processor::fftSize / 8, "87.5%" }
+    };
+
+    for (const auto& overlap : overlaps) {
+        const auto hopSize = overlap.first;
+        menu.addItem(overlap.second, true, spectrumEngine.getHopSize() == hopSize, [this, hopSize] {
+            spectrumEngine.setHopSize(hopSize);
+        });
+    }
+
+    menu.showMenuAsync(PopupMenu::Options().withMousePosition());
 }
 
-void Editor::sliderValueChanged(Slider* slider)
+void Editor::timerCallback()
 {
-    if (slider == &thresholdSlider) {
-        processorRef.setCompressorThreshold(processorRef.apvts.getRawParameterValue("threshold")->load());
-    } else if (slider == &cutoffSlider) {
-        processorRef.setFilterCutoff(processorRef.apvts.getRawParameterValue("cutoff")->load());
-	}
+    TRACE_SCOPE("Editor::timerCallback");
+
+    // Drain every meter reading since the last frame, so no block and no peak is missed
+    double dryPower = 0.0;
+    double wetPower = 0.0;
+    int numSamples = 0;
+    float dryPeak = 0.0f;
+    float wetPeak = 0.0f;
+    float gainReduction = 0.0f;
+    bool idle = true;
+
+    processorRef.popMeterReadings([&](const Processor::MeterReadings::Reading& reading) {
+        dryPower += (double)reading.dryRms * reading.dryRms * reading.numSamples;
+        wetPower += (double)reading.wetRms * reading.wetRms * reading.numSamples;
+        numSamples += reading.numSamples;
+        dryPeak = jmax(dryPeak, reading.dryPeak);
+        wetPeak = jmax(wetPeak, reading.wetPeak);
+        gainReduction = jmax(gainReduction, reading.gainReduction);
+        idle = idle && reading.idle;
+    });
+
+    // The history advances once per frame, frames without audio, such as
+    // while the transport is stopped, scroll in as silence
+    if (numSamples > 0) {
+        float dryRmsValue = jlimit(levelMeter.mindB, levelMeter.maxdB, Decibels::gainToDecibels((float)std::sqrt(dryPower / numSamples)));
+        float wetRmsValue = jlimit(levelMeter.mindB, levelMeter.maxdB, Decibels::gainToDecibels((float)std::sqrt(wetPower / numSamples)));
+
+        levelMeter.fillRmsValues(dryRmsValue, wetRmsValue);
+
+        // Idle once a whole frame went by without the processor running its chain
+        levelMeter.setIdle(idle);
+    }
+    else {
+        levelMeter.fillRmsValues(levelMeter.mindB, levelMeter.mindB);
+    }
+
+    // The peak markers keep falling while no audio arrives
+    levelMeter.setPeakLevels(Decibels::gainToDecibels(dryPeak), Decibels::gainToDecibels(wetPeak), gainReduction);
+
+    // Update the spectrum analyzer with the latest spectra from the analysis thread
+    if (spectrumEngine.getLatestSpectra(dryScopeData, wetScopeData)) {
+        spectrumAnalyzer.updateSpectra(dryScopeData, wetScopeData);
+    }
+    else {
+        // The cutoff and bypass can change without new spectra
+        spectrumAnalyzer.repaint();
+    }
 }
@@ -2,11 +2,14 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "CachedLayer.h"
+#include "DiagnosticsPanel.h"
 #include "LevelMeter.h"
 #include "SpectrumAnalyzer.h"
+#include "SpectrumEngine.h"
 #include "CustomLookAndFeel.h"
 
-class Editor final : public AudioProcessorEditor, public Timer, public Slider::Listener
+class Editor final : public AudioProcessorEditor, public Timer
 {
 public:
     explicit Editor (Processor&);
@@ -16,22 +19,24 @@ public:
     void resized() override;
 
     void timerCallback() override;
-    void sliderValueChanged(Slider*) override;
+
+    // Right clicking the spectrum analyzer picks the overlap of its frames
+    void mouseDown(const MouseEvent&) override;
 
 private:
+    void renderBackground(float);
+    void drawBackground(Graphics&);
+    void layoutDiagnostics();
+
     Processor& processorRef;
 
     // Title
     Typeface::Ptr typeface = Typeface::createSystemTypefaceFor(BinaryData::kraut____typefuck11_ttf, BinaryData::kraut____typefuck11_ttfSize);
 
-    // FFT
-    const static int interpolatedSize = 16000;
-    dsp::FFT forwardFFT;
-    dsp::WindowingFunction<float> window;
-    LagrangeInterpolator dryLagrangeInterpolator;
-    LagrangeInterpolator wetLagrangeInterpolator;
-    float dryInterpolatedFftData[interpolatedSize];
-    float wetInterpolatedFftData[interpolatedSize];
+    // Spectrum analysis
+    SpectrumEngine spectrumEngine;
+    float dryScopeData[SpectrumEngine::scopeSize];
+    float wetScopeData[SpectrumEngine::scopeSize];
 
     // Components
     LevelMeter levelMeter;
@@ -41,6 +46,9 @@ private:
     DropShadow shadow;
     DropShadow light;
 
+    // Background, title and the shadows of the components, none of which change between frames
+    CachedLayer backgroundLayer;
+
     // Sliders and buttons
     Slider thresholdSlider;
     Slider cutoffSlider;
@@ -49,6 +57,9 @@ private:
     ToggleButton bypassButton;
     std::unique_ptr<AudioProcessorValueTreeState::ButtonAttachment> bypassButtonAttachment;
 
+    // Load and stage timing, on top of everything else
+    DiagnosticsPanel diagnosticsPanel;
+
     // LookAndFeel
     CustomLookAndFeel lookAndFeel;
 
@@ -1,5 +1,6 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
+#include "AllocationGuard.h"
 
 Processor::Processor()
      : AudioProcessor (BusesProperties()
@@ -13,10 +14,29 @@ Processor::Processor()
     apvts(*this, nullptr, "PARAMETERS", createParameters())
 {
     apvts.state = ValueTree("PARAMETERS");
+
+    thresholdParameter = apvts.getRawParameterValue("threshold");
+    cutoffParameter = apvts.getRawParameterValue("cutoff");
+    bypassParameter = apvts.getRawParameterValue("bypass");
+    attackParameter = apvts.getRawParameterValue("attack");
+    releaseParameter = apvts.getRawParameterValue("release");
+    ratioParameter = apvts.getRawParameterValue("ratio");
+    detectionParameter = apvts.getRawParameterValue("detection");
+    oversamplingParameter = apvts.getRawParameterValue("oversampling");
+    oversamplingModeParameter = apvts.getRawParameterValue("oversamplingMode");
+    lookaheadParameter = apvts.getRawParameterValue("lookahead");
+    highpassModeParameter = apvts.getRawParameterValue("highpassMode");
+    modulationSourceParameter = apvts.getRawParameterValue("modulationSource");
+    modulationDepthParameter = apvts.getRawParameterValue("modulationDepth");
+    modulationRateParameter = apvts.getRawParameterValue("modulationRate");
+
+    // Picks up latency changes made by the audio thread
+    startTimerHz(10);
 }
 
 Processor::~Processor()
 {
+    stopTimer();
 }
 
 const String Processor::getName() const
@@ -53,7 +73,7 @@ bool Processor::isMidiEffect() const
 
 double Processor::getTailLengthSeconds() const
 {
-    return 0.0;
+    return tailLengthSeconds.load();
 }
 
 int Processor::getNumPrograms()
@@ -89,21 +109,137 @@ void Processor::prepareToPlay (double sampleRate, int samplesPerBlock)
     spec.maximumBlockSize = uint32(samplesPerBlock);
     spec.numChannels = uint32(getTotalNumOutputChannels());
 
-    compressor.prepare(spec);
-    compressor.setThreshold(apvts.getRawParameterValue("threshold")->load());
-    compressor.setRatio(8.0f);
-    compressor.setAttack(20.0f);
-    compressor.setRelease(20.0f);
+    // Start from the current parameter values without a ramp
+    smoothedThreshold.reset(sampleRate, smoothingTime);
+    smoothedThreshold.setCurrentAndTargetValue(thresholdParameter->load());
+    smoothedCutoff.reset(sampleRate, smoothingTime);
+    smoothedCutoff.setCurrentAndTargetValue(cutoffParameter->load());
+    bypassMix.reset(sampleRate, bypassFadeTime);
+    bypassMix.setCurrentAndTargetValue(bypassParameter->load() > 0.5f ? 1.0f : 0.0f);
+
+    compressor.setThreshold(smoothedThreshold.getCurrentValue());
+
+    baseSampleRate = sampleRate;
+    maxChunkSize = (size_t)samplesPerBlock;
+
+    processingStats.prepare(sampleRate, samplesPerBlock);
+
+    silentSamples = 0;
+    idle = false;
+
+    // Only the chain of the precision the host asked for holds any memory
+    if (isUsingDoublePrecision()) {
+        releaseChain(floatChain);
+        prepareChain(doubleChain, spec);
+    }
+    else {
+        releaseChain(doubleChain);
+        prepareChain(floatChain, spec);
+    }
+
+    const auto maxOversampledBlockSize = samplesPerBlock << maxOversamplingOrder;
+
+    tapBuffer.setSize(2, maxOversampledBlockSize);
+    tapBuffer.clear();
+
+    const auto maxNumSteps = ((size_t)maxOversampledBlockSize + parameterStepSize - 1) / parameterStepSize;
+    thresholdSteps.resize(maxNumSteps);
+    cutoffSteps.resize(maxNumSteps);
+    bypassRamp.resize((size_t)maxOversampledBlockSize);
+
+    // Prepares the compressor and the highpass at the oversampled rate
+    oversamplingOrder = -1;
+    lookaheadSamples = -1;
+    highpassMode = -1;
+    updateParameters();
+
+    // Start at the lookahead instead of fading to it
+    forActiveChain([](auto& chain) {
+        chain.lookahead.reset();
+    });
+
+    // Designs the first linear phase kernel for the current cutoff and rate
+    linearPhaseHighpass.setCutoffFrequency(smoothedCutoff.getCurrentValue());
+    linearPhaseHighpass.prepare({ sampleRate * (double)oversamplingFactor, (uint32)maxOversampledBlockSize, spec.numChannels });
+
+    // The host is stopped, so the latency can be reported right away
+    setLatencySamples(latencySamples.load());
+}
+
+template <typename SampleType>
+void Processor::prepareChain(Chain<SampleType>& chain, const dsp::ProcessSpec& spec)
+{
+    const auto samplesPerBlock = (int)spec.maximumBlockSize;
+
+    // Build every oversampling stage up front, with integer latency so it can be reported exactly
+    for (int mode = 0; mode < numOversamplingModes; ++mode) {
+        const auto filterType = mode == 0 ? dsp::Oversampling<SampleType>::filterHalfBandPolyphaseIIR
+                                          : dsp::Oversampling<SampleType>::filterHalfBandFIREquiripple;
+
+        for (int order = 1; order <= maxOversamplingOrder; ++order) {
+            auto& stage = chain.oversamplers[mode][order - 1];
+            stage = std::make_unique<dsp::Oversampling<SampleType>>((size_t)spec.numChannels, (size_t)order, filterType, true, true);
+            stage->initProcessing((size_t)samplesPerBlock);
+        }
+    }
+
+    chain.oversampling = nullptr;
+
+    // Size the scratch bus once for the highest factor, so the audio callback never has to allocate
+    const auto maxOversampledBlockSize = samplesPerBlock << maxOversamplingOrder;
+
+    chain.dryBuffer.setSize((int)spec.numChannels, maxOversampledBlockSize);
+    chain.dryBuffer.clear();
+
+    chain.highpass.setCutoffFrequency(smoothedCutoff.getCurrentValue());
+
+    // The lookahead delay runs at the oversampled rate as well
+    const auto maxLookaheadSamples = (int)std::ceil(maxLookaheadTime * spec.sampleRate) << maxOversamplingOrder;
+    chain.lookahead.prepare({ spec.sampleRate, (uint32)maxOversampledBlockSize, spec.numChannels }, maxLookaheadSamples);
+
+    chain.linearPhaseDryDelay.prepare({ spec.sampleRate, (uint32)maxOversampledBlockSize, spec.numChannels }, LinearPhaseHighpass::latencyInSamples);
+    chain.linearPhaseDryDelay.setDelay(LinearPhaseHighpass::latencyInSamples);
+
+    // Pick the fused kernel once, the common layouts get their channel loops unrolled
+    switch (spec.numChannels) {
+        case 1:  chain.fusedKernel = &Processor::processChunkFused<SampleType, 1>; break;
+        case 2:  chain.fusedKernel = &Processor::processChunkFused<SampleType, 2>; break;
+        case 6:  chain.fusedKernel = &Processor::processChunkFused<SampleType, 6>; break;
+        case 8:  chain.fusedKernel = &Processor::processChunkFused<SampleType, 8>; break;
+        default: chain.fusedKernel = &Processor::processChunkFused<SampleType, 0>; break;
+    }
+}
+
+template <typename SampleType>
+void Processor::releaseChain(Chain<SampleType>& chain)
+{
+    chain.dryBuffer.setSize(0, 0);
+    chain.oversampling = nullptr;
+
+    for (auto& stages : chain.oversamplers) {
+        for (auto& stage : stages) {
+            stage.reset();
+        }
+    }
+}
 
-    for (int i = 0; i < numFilters; ++i) {
-        filter[i].prepare(spec);
-        filter[i].setType(dsp::StateVariableTPTFilterType::highpass);
-        filter[i].setCutoffFrequency(apvts.getRawParameterValue("cutoff")->load());
-	}
+template <typename SampleType>
+Processor::Chain<SampleType>& Processor::getChain()
+{
+    if constexpr (std::is_same_v<SampleType, double>) {
+        return doubleChain;
+    }
+    else {
+        return floatChain;
+    }
 }
 
 void Processor::releaseResources()
 {
+    releaseChain(floatChain);
+    releaseChain(doubleChain);
+    tapBuffer.setSize(0, 0);
+    maxChunkSize = 0;
 }
 
 bool Processor::isBusesLayoutSupported (const BusesLayout& layouts) const
@@ -113,8 +249,8 @@ bool Processor::isBusesLayoutSupported (const BusesLayout& layouts) const
     return true;
   #else
 
-    if (layouts.getMainOutputChannelSet() != AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != AudioChannelSet::stereo())
+    if (layouts.getMainOutputChannelSet().isDisabled()
+     || layouts.getMainOutputChannelSet().size() > maxNumChannels)
         return false;
 
    #if ! JucePlugin_IsSynth
@@ -128,61 +264,631 @@ bool Processor::isBusesLayoutSupported (const BusesLayout& layouts) const
 
 void Processor::processBlock (AudioBuffer<float>& buffer, MidiBuffer& /*midiMessages*/)
 {
+    processSamples(buffer);
+}
+
+void Processor::processBlock (AudioBuffer<double>& buffer, MidiBuffer& /*midiMessages*/)
+{
+    processSamples(buffer);
+}
+
+bool Processor::supportsDoublePrecisionProcessing() const
+{
+    return true;
+}
+
+template <typename SampleType>
+void Processor::processSamples(AudioBuffer<SampleType>& buffer)
+{
+    TRACE_SCOPE("processBlock");
     ScopedNoDenormals noDenormals;
+    ScopedAllocationGuard allocationGuard;
     auto totalNumInputChannels  = getTotalNumInputChannels();
     auto totalNumOutputChannels = getTotalNumOutputChannels();
 
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
 
-    // Get copies of the buffer
-    AudioSampleBuffer drySignalBuffer;
-    drySignalBuffer.makeCopyOf(buffer);
-    AudioSampleBuffer wetSignalBuffer;
-    wetSignalBuffer.makeCopyOf(buffer);
+    auto& chain = getChain<SampleType>();
+
+    // prepareToPlay must have sized the scratch bus, for the precision of this call
+    jassert(maxChunkSize > 0 && chain.dryBuffer.getNumSamples() > 0);
+
+    if (maxChunkSize == 0 || chain.dryBuffer.getNumSamples() == 0) {
+        return;
+    }
+
+    processingStats.beginCallback();
+    updateParameters();
+
+    // Hosts may send more samples than announced, so work through the buffer in
+    // chunks that fit the preallocated scratch bus
+    dsp::AudioBlock<SampleType> block(buffer);
+    block = block.getSubsetChannelBlock(0, jmin(block.getNumChannels(), (size_t)chain.dryBuffer.getNumChannels()));
+
+    // A buffer with fewer channels than prepared falls back to the generic kernel
+    const auto kernel = block.getNumChannels() == (size_t)chain.dryBuffer.getNumChannels() ? chain.fusedKernel : &Processor::processChunkFused<SampleType, 0>;
+
+    const auto inputSilent = getPeakLevel(block) <= (SampleType)silenceThreshold;
+    silentSamples = inputSilent ? silentSamples + (int64)block.getNumSamples() : 0;
+
+    if (idle && inputSilent) {
+        block.clear();
+
+        // The parameters land on their targets, the next signal starts from them
+        smoothedThreshold.setCurrentAndTargetValue(smoothedThreshold.getTargetValue());
+        smoothedCutoff.setCurrentAndTargetValue(smoothedCutoff.getTargetValue());
+        bypassMix.setCurrentAndTargetValue(bypassMix.getTargetValue());
+
+        pushIdleReadings(block.getNumSamples());
+        processingStats.endCallback(buffer.getNumSamples());
+        return;
+    }
+
+    idle = false;
+
+    for (size_t startSample = 0; startSample < block.getNumSamples(); startSample += maxChunkSize) {
+        auto chunk = block.getSubBlock(startSample, jmin(maxChunkSize, block.getNumSamples() - startSample));
+        auto processed = chunk;
+
+        if (chain.oversampling != nullptr) {
+            ProcessingStats::ScopedStage stage(processingStats, ProcessingStats::oversampling);
+            processed = chain.oversampling->processSamplesUp(chunk).getSubsetChannelBlock(0, chunk.getNumChannels());
+        }
+
+        advanceSmoothedParameters(processed.getNumSamples());
+
+        if (switches.fusedProcessing.load(std::memory_order_relaxed)) {
+            (this->*kernel)(processed);
+        }
+        else {
+            processChunkMultiPass(processed);
+        }
+
+        if (chain.oversampling != nullptr) {
+            ProcessingStats::ScopedStage stage(processingStats, ProcessingStats::oversampling);
+            chain.oversampling->processSamplesDown(chunk);
+        }
+    }
+
+    // After the hold, output below the floor means the filters have decayed
+    // and what is left of their state is residue. A long release keeps the
+    // chain running until the envelopes have followed the silence down too.
+    if (silentSamples >= silenceHoldSamples && inputSilent && getPeakLevel(block) <= (SampleType)silenceThreshold
+        && compressor.isSettled((float)silenceThreshold)) {
+        block.clear();
+        resetProcessingState();
+        idle = true;
+        idleTapSamples = 0;
+    }
+
+    processingStats.endCallback(buffer.getNumSamples());
+}
+
+void Processor::updateParameters()
+{
+    // Read every parameter once per block
+    smoothedThreshold.setTargetValue(thresholdParameter->load());
+    smoothedCutoff.setTargetValue(cutoffParameter->load());
+    bypassMix.setTargetValue(bypassParameter->load() > 0.5f ? 1.0f : 0.0f);
+
+    compressor.setAttack(attackParameter->load());
+    compressor.setRelease(releaseParameter->load());
+    compressor.setRatio(ratioParameter->load());
+    compressor.setDetection((Compressor::Detection)(int)detectionParameter->load());
+
+    cutoffModulator.setSource((CutoffModulator::Source)(int)modulationSourceParameter->load());
+    cutoffModulator.setDepth(modulationDepthParameter->load());
+    cutoffModulator.setRate(modulationRateParameter->load());
+
+    updateOversampling((int)oversamplingParameter->load(), (int)oversamplingModeParameter->load());
+    updateLookahead(lookaheadParameter->load());
+    updateHighpassMode((int)highpassModeParameter->load());
+}
+
+void Processor::updateOversampling(int newOrder, int newMode)
+{
+    if (newOrder == oversamplingOrder && newMode == oversamplingMode) {
+        return;
+    }
+
+    oversamplingOrder = newOrder;
+    oversamplingMode = newMode;
+    oversamplingFactor = (size_t)1 << newOrder;
+
+    // Preparing again with the same channel count and block size only
+    // recomputes the coefficients for the new rate, it does not allocate
+    const auto sampleRate = baseSampleRate * (double)oversamplingFactor;
+
+    forActiveChain([&](auto& chain) {
+        chain.oversampling = newOrder > 0 ? chain.oversamplers[newMode][newOrder - 1].get() : nullptr;
+
+        if (chain.oversampling != nullptr) {
+            chain.oversampling->reset();
+        }
+
+        dsp::ProcessSpec spec;
+        spec.sampleRate = sampleRate;
+        spec.maximumBlockSize = uint32(maxChunkSize << maxOversamplingOrder);
+        spec.numChannels = uint32(chain.dryBuffer.getNumChannels());
+
+        compressor.prepare(spec);
+        chain.highpass.prepare(spec);
+        chain.linearPhaseDryDelay.reset();
+
+        // The delay line holds samples at the old rate, so it jumps to the new delay
+        chain.lookahead.setDelay(jmax(0, lookaheadSamples) * (int)oversamplingFactor);
+        chain.lookahead.reset();
+    });
+
+    cutoffModulator.prepare(sampleRate);
+    maxModulatedCutoff = (float)jmin(20000.0, 0.45 * sampleRate);
+
+    linearPhaseHighpass.setSampleRate(sampleRate);
+    linearPhaseHighpass.reset();
+
+    // The smoothers count oversampled samples, they land on their targets here
+    smoothedThreshold.reset(sampleRate, smoothingTime);
+    smoothedCutoff.reset(sampleRate, smoothingTime);
+    bypassMix.reset(sampleRate, bypassFadeTime);
+
+    updateLatency();
+}
+
+void Processor::updateLookahead(float lookaheadMs)
+{
+    // Whole samples at the base rate, so the latency can be reported exactly
+    const auto newLookaheadSamples = roundToInt(lookaheadMs * 0.001 * baseSampleRate);
+
+    if (newLookaheadSamples == lookaheadSamples) {
+        return;
+    }
+
+    lookaheadSamples = newLookaheadSamples;
+
+    forActiveChain([&](auto& chain) {
+        chain.lookahead.setDelay(lookaheadSamples * (int)oversamplingFactor);
+    });
+
+    updateLatency();
+}
+
+void Processor::updateHighpassMode(int newMode)
+{
+    if (newMode == highpassMode) {
+        return;
+    }
+
+    highpassMode = newMode;
+    linearPhase = newMode == 1;
+
+    // The designer only runs in linear phase mode, starting from the current cutoff
+    linearPhaseHighpass.setCutoffFrequency(smoothedCutoff.getCurrentValue());
+    linearPhaseHighpass.setActive(linearPhase);
+    linearPhaseHighpass.reset();
+
+    forActiveChain([](auto& chain) {
+        chain.linearPhaseDryDelay.reset();
+    });
+
+    updateLatency();
+}
+
+void Processor::updateLatency()
+{
+    auto latency = jmax(0, lookaheadSamples);
+
+    forActiveChain([&latency](auto& chain) {
+        if (chain.oversampling != nullptr) {
+            latency += roundToInt(chain.oversampling->getLatencyInSamples());
+        }
+    });
+
+    // A whole number of base rate samples at every oversampling factor
+    if (linearPhase) {
+        latency += LinearPhaseHighpass::latencyInSamples / (int)oversamplingFactor;
+    }
+
+    // Silent input has to run through the delays and the second half of the
+    // linear phase kernel, and the cascade has to decay, before the chain can go idle
+    silenceHoldSamples = 2 * latency + roundToInt(maxDecayTime * baseSampleRate);
+    tailLengthSeconds.store((double)silenceHoldSamples / baseSampleRate);
+
+    // Reported to the host from the message thread, see timerCallback
+    latencySamples.store(latency);
+}
+
+void Processor::timerCallback()
+{
+    const auto latency = latencySamples.load();
+
+    if (latency != getLatencySamples()) {
+        setLatencySamples(latency);
+    }
+}
+
+void Processor::resetProcessingState()
+{
+    compressor.reset();
+    cutoffModulator.reset();
+    linearPhaseHighpass.reset();
+
+    forActiveChain([](auto& chain) {
+        if (chain.oversampling != nullptr) {
+            chain.oversampling->reset();
+        }
+
+        chain.lookahead.reset();
+        chain.highpass.reset();
+        chain.linearPhaseDryDelay.reset();
+    });
+}
+
+void Processor::advanceSmoothedParameters(size_t numSamples)
+{
+    // One threshold and cutoff value per sub-block
+    for (size_t step = 0; step * parameterStepSize < numSamples; ++step) {
+        const auto stepSize = (int)jmin(parameterStepSize, numSamples - step * parameterStepSize);
+
+        thresholdSteps[step] = smoothedThreshold.getCurrentValue();
+        cutoffSteps[step] = smoothedCutoff.getCurrentValue();
+        smoothedThreshold.skip(stepSize);
+        smoothedCutoff.skip(stepSize);
+    }
+
+    // One bypass mix value per sample while fading
+    bypassFading = bypassMix.isSmoothing();
+
+    if (bypassFading) {
+        for (size_t i = 0; i < numSamples; ++i) {
+            bypassRamp[i] = bypassMix.getNextValue();
+        }
+    }
+
+    bypassed = bypassMix.getCurrentValue() > 0.5f;
+}
+
+template <typename SampleType>
+void Processor::processChunkMultiPass(dsp::AudioBlock<SampleType> block)
+{
+    auto& chain = getChain<SampleType>();
+    const auto numChannels = block.getNumChannels();
+    const auto numSamples = block.getNumSamples();
+
+    auto dryBlock = dsp::AudioBlock<SampleType>(chain.dryBuffer).getSubsetChannelBlock(0, block.getNumChannels()).getSubBlock(0, numSamples);
+
+    {
+        ProcessingStats::ScopedStage stage(processingStats, ProcessingStats::compressor);
+
+        // Delay the signal into the dry bus, the block keeps the undelayed input for detection
+        chain.lookahead.process(block, dryBlock);
+
+        // Apply compression to the delayed signal
+        for (size_t startSample = 0, step = 0; startSample < numSamples; startSample += parameterStepSize, ++step) {
+            const auto stepSize = jmin(parameterStepSize, numSamples - startSample);
+            const auto stepBlock = block.getSubBlock(startSample, stepSize);
+
+            compressor.setThreshold(thresholdSteps[step]);
+            compressor.process(stepBlock, dryBlock.getSubBlock(startSample, stepSize), stepBlock);
+        }
+
+        compressor.snapToZero();
+    }
+
+    const bool analyzerActive = switches.analyzerEnabled.load(std::memory_order_relaxed);
+    const auto mixdownGain = 1.0f / (float)numChannels;
+    auto* dryTap = tapBuffer.getWritePointer(0);
+    auto* wetTap = tapBuffer.getWritePointer(1);
+
+    {
+        ProcessingStats::ScopedStage stage(processingStats, ProcessingStats::taps);
+
+        // Meter the dry and the compressed signal
+        double drySquaredSum[maxNumChannels] = {};
+        double wetSquaredSum[maxNumChannels] = {};
+        auto dryPeak = 0.0f;
+        auto wetPeak = 0.0f;
+
+        for (size_t channel = 0; channel < numChannels; ++channel) {
+            accumulateLevels(dryBlock.getChannelPointer(channel), numSamples, drySquaredSum[channel], dryPeak);
+            accumulateLevels(block.getChannelPointer(channel), numSamples, wetSquaredSum[channel], wetPeak);
+        }
+
+        pushMeterReading(drySquaredSum, wetSquaredSum, dryPeak, wetPeak, numChannels, numSamples);
+
+        // Tap the compressed signal
+        if (analyzerActive) {
+            for (size_t channel = 0; channel < numChannels; ++channel) {
+                addToMixdown(dryTap, block.getChannelPointer(channel), numSamples, mixdownGain, channel == 0);
+            }
+        }
+    }
+
+    {
+        ProcessingStats::ScopedStage stage(processingStats, ProcessingStats::highpass);
+
+        for (size_t startSample = 0, step = 0; startSample < numSamples; startSample += parameterStepSize, ++step) {
+            const auto stepSize = jmin(parameterStepSize, numSamples - startSample);
+            applyHighpass(block.getSubBlock(startSample, stepSize), dryBlock.getSubBlock(startSample, stepSize), cutoffSteps[step]);
+        }
+
+        chain.highpass.snapToZero();
+    }
+
+    // Tap the filtered signal
+    if (analyzerActive) {
+        ProcessingStats::ScopedStage stage(processingStats, ProcessingStats::taps);
+
+        for (size_t channel = 0; channel < numChannels; ++channel) {
+            addToMixdown(wetTap, block.getChannelPointer(channel), numSamples, mixdownGain, channel == 0);
+        }
+
+        pushAnalyzerTaps(dryTap, wetTap, numSamples);
+    }
+
+    ProcessingStats::ScopedStage stage(processingStats, ProcessingStats::mix);
+
+    for (size_t channel = 0; channel < numChannels; ++channel) {
+        mixChannel(block.getChannelPointer(channel), dryBlock.getChannelPointer(channel), numSamples, 0);
+    }
+}
+
+template <typename SampleType, int fixedNumChannels>
+void Processor::processChunkFused(dsp::AudioBlock<SampleType> block)
+{
+    auto& chain = getChain<SampleType>();
+    // A compile-time channel count lets the compiler unroll the channel loops
+    const auto numChannels = fixedNumChannels > 0 ? (size_t)fixedNumChannels : block.getNumChannels();
+    const auto numSamples = block.getNumSamples();
+    const bool analyzerActive = switches.analyzerEnabled.load(std::memory_order_relaxed);
+    const auto mixdownGain = 1.0f / (float)numChannels;
+
+    jassert(numChannels == block.getNumChannels() && numChannels <= (size_t)maxNumChannels);
+
+    double drySquaredSum[maxNumChannels] = {};
+    double wetSquaredSum[maxNumChannels] = {};
+    auto dryPeak = 0.0f;
+    auto wetPeak = 0.0f;
+
+    // Run the whole chain over short sections, so the block is only walked
+    // once while it is still in cache
+    for (size_t startSample = 0, step = 0; startSample < numSamples; startSample += fusedSectionSize, ++step) {
+        const auto sectionSize = jmin(fusedSectionSize, numSamples - startSample);
+        auto section = block.getSubBlock(startSample, sectionSize);
+
+        const auto drySection = dsp::AudioBlock<SampleType>(chain.dryBuffer).getSubsetChannelBlock(0, numChannels).getSubBlock(startSample, sectionSize);
+
+        {
+            ProcessingStats::ScopedStage stage(processingStats, ProcessingStats::compressor);
+            compressor.setThreshold(thresholdSteps[step]);
+
+            // Delay the section into the dry bus and compress the delayed signal,
+            // with the gains detected on the undelayed input
+            chain.lookahead.process(section, drySection);
+            compressor.process(section, drySection, section);
+        }
+
+        {
+            ProcessingStats::ScopedStage stage(processingStats, ProcessingStats::taps);
+
+            // Meter and tap the compressed signal
+            for (size_t channel = 0; channel < numChannels; ++channel) {
+                const auto* samples = section.getChannelPointer(channel);
+                const auto* drySamples = chain.dryBuffer.getReadPointer((int)channel, (int)startSample);
+
+                accumulateLevels(drySamples, sectionSize, drySquaredSum[channel], dryPeak);
+                accumulateLevels(samples, sectionSize, wetSquaredSum[channel], wetPeak);
+
+                if (analyzerActive) {
+                    addToMixdown(dryTapSection, samples, sectionSize, mixdownGain, channel == 0);
+                }
+            }
+        }
+
+        {
+            ProcessingStats::ScopedStage stage(processingStats, ProcessingStats::highpass);
+
+            // Filter all channels together
+            applyHighpass(section, drySection, cutoffSteps[step]);
+        }
+
+        // Tap the filtered signal while the section is still in cache
+        if (analyzerActive) {
+            ProcessingStats::ScopedStage stage(processingStats, ProcessingStats::taps);
+
+            for (size_t channel = 0; channel < numChannels; ++channel) {
+                addToMixdown(wetTapSection, section.getChannelPointer(channel), sectionSize, mixdownGain, channel == 0);
+            }
+
+            pushAnalyzerTaps(dryTapSection, wetTapSection, sectionSize);
+        }
+
+        {
+            ProcessingStats::ScopedStage stage(processingStats, ProcessingStats::mix);
+
+            // Mix dry signal with phase inverted wet signal
+            for (size_t channel = 0; channel < numChannels; ++channel) {
+                mixChannel(section.getChannelPointer(channel), chain.dryBuffer.getReadPointer((int)channel, (int)startSample), sectionSize, startSample);
+            }
+        }
+    }
+
+    compressor.snapToZero();
+    chain.highpass.snapToZero();
+
+    pushMeterReading(drySquaredSum, wetSquaredSum, dryPeak, wetPeak, numChannels, numSamples);
+}
+
+template <typename SampleType>
+void Processor::applyHighpass(const dsp::AudioBlock<SampleType>& block, const dsp::AudioBlock<SampleType>& dryBlock, float cutoff)
+{
+    auto& highpass = getChain<SampleType>().highpass;
+
+    if (!cutoffModulator.isActive()) {
+        highpass.setCutoffFrequency(cutoff);
+    }
+
+    if (linearPhase) {
+        // The kernel cannot be redesigned at audio rate, so it ignores the modulation
+        linearPhaseHighpass.setCutoffFrequency(cutoff);
+        linearPhaseHighpass.process(block);
+        getChain<SampleType>().linearPhaseDryDelay.process(dryBlock, dryBlock);
+    }
+    else if (cutoffModulator.isActive()) {
+        // Ramp the coefficients to the modulated cutoff over every modulation step
+        for (size_t startSample = 0; startSample < block.getNumSamples(); startSample += CutoffModulator::stepSize) {
+            const auto step = block.getSubBlock(startSample, jmin(CutoffModulator::stepSize, block.getNumSamples() - startSample));
+            const auto modulatedCutoff = cutoff * cutoffModulator.getNextMultiplier(step);
+
+            highpass.process(step, jlimit(minModulatedCutoff, maxModulatedCutoff, modulatedCutoff));
+        }
+    }
+    else {
+        highpass.process(block);
+    }
+}
+
+template <typename SampleType>
+void Processor::mixChannel(SampleType* samples, const SampleType* drySamples, size_t numSamples, size_t rampOffset) const
+{
+    if (bypassFading) {
+        // Equal-gain crossfade, the dry and processed signals are correlated.
+        // dry - (1 - mix) * wet is the processed signal faded into the dry one.
+        const auto* mix = bypassRamp.data() + rampOffset;
+
+        for (size_t i = 0; i < numSamples; ++i) {
+            samples[i] = drySamples[i] - (SampleType)(1.0f - mix[i]) * samples[i];
+        }
+    }
+    else if (bypassed) {
+        FloatVectorOperations::copy(samples, drySamples, (int)numSamples);
+    }
+    else {
+        // Mix dry signal with phase inverted wet signal
+        FloatVectorOperations::subtract(samples, drySamples, samples, (int)numSamples);
+    }
+}
+
+void Processor::pushAnalyzerTaps(float* dryTap, float* wetTap, size_t numSamples)
+{
+    // The analyzer runs at the base rate, so keep every factor-th sample of
+    // oversampled taps. Anything above the base Nyquist folds back, which
+    // only affects the display.
+    if (oversamplingFactor > 1) {
+        numSamples /= oversamplingFactor;
+
+        for (size_t i = 0; i < numSamples; ++i) {
+            dryTap[i] = dryTap[i * oversamplingFactor];
+            wetTap[i] = wetTap[i * oversamplingFactor];
+        }
+    }
+
+    analyzerFifo.push(dryTap, wetTap, (int)numSamples);
+}
+
+void Processor::pushMeterReading(const double* drySquaredSum, const double* wetSquaredSum, float dryPeak, float wetPeak,
+                                 size_t numChannels, size_t numSamples)
+{
+    // Taken every chunk, so it covers exactly the samples of the reading
+    const auto gainReduction = compressor.getAndResetGainReduction();
+
+    if (!switches.meteringEnabled.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    // The RMS of all channels together, not the average of their levels
+    auto dryPower = 0.0;
+    auto wetPower = 0.0;
+
+    for (size_t channel = 0; channel < numChannels; ++channel) {
+        dryPower += drySquaredSum[channel];
+        wetPower += wetSquaredSum[channel];
+    }
 
-    // Apply compression
-    dsp::AudioBlock<float> compressorBlock(wetSignalBuffer);
-    dsp::ProcessContextReplacing<float> compressorContext(compressorBlock);
-    compressor.process(compressorContext);
+    const auto numValues = (double)(numChannels * numSamples);
 
-    // Get rms values
-    dryRmsValue = Decibels::gainToDecibels((buffer.getRMSLevel(0, 0, drySignalBuffer.getNumSamples()) + drySignalBuffer.getRMSLevel(1, 0, drySignalBuffer.getNumSamples())) / 2.0f);
-    wetRmsValue = Decibels::gainToDecibels((wetSignalBuffer.getRMSLevel(0, 0, wetSignalBuffer.getNumSamples()) + wetSignalBuffer.getRMSLevel(1, 0, wetSignalBuffer.getNumSamples())) / 2.0f);
+    MeterReadings::Reading reading;
+    reading.dryPeak = dryPeak;
+    reading.dryRms = (float)std::sqrt(dryPower / numValues);
+    reading.wetPeak = wetPeak;
+    reading.wetRms = (float)std::sqrt(wetPower / numValues);
+    reading.gainReduction = gainReduction;
+    reading.numSamples = (int)(numSamples / oversamplingFactor);
+    reading.idle = false;
 
-    // Push samples into dry fifo
-    for (int sampleIndex = 0; sampleIndex < buffer.getNumSamples(); ++sampleIndex) {
-        float wetSample = 0.5f * wetSignalBuffer.getSample(0, sampleIndex) + 0.5f * wetSignalBuffer.getSample(1, sampleIndex);
-        pushNextDrySampleIntoFifo(wetSample);
+    meterFifo.push(reading);
+}
+
+void Processor::pushIdleReadings(size_t numSamples)
+{
+    // One silent reading per callback keeps the meters falling
+    if (switches.meteringEnabled.load(std::memory_order_relaxed)) {
+        MeterReadings::Reading reading {};
+        reading.numSamples = (int)numSamples;
+        reading.idle = true;
+
+        meterFifo.push(reading);
     }
 
-    for (int i = 0; i < numFilters; ++i) {
-        dsp::AudioBlock<float> filterBlock(wetSignalBuffer);
-        dsp::ProcessContextReplacing<float> filterContext(filterBlock);
-        filter[i].process(filterContext);
-	}
+    // One window of silent taps clears the spectrum, after that the analyzer has nothing to do
+    if (switches.analyzerEnabled.load(std::memory_order_relaxed) && idleTapSamples < fftSize) {
+        auto* dryTap = tapBuffer.getWritePointer(0);
+        auto* wetTap = tapBuffer.getWritePointer(1);
 
-    // Push samples into wet fifo
-    for (int sampleIndex = 0; sampleIndex < buffer.getNumSamples(); ++sampleIndex) {
-		float wetSample = 0.5f * wetSignalBuffer.getSample(0, sampleIndex) + 0.5f * wetSignalBuffer.getSample(1, sampleIndex);
-		pushNextWetSampleIntoFifo(wetSample);
-	}
+        // Hosts may send more samples than the tap buffer holds, the rest follows in later callbacks
+        const auto numTaps = jmin((int)numSamples, tapBuffer.getNumSamples(), fftSize - idleTapSamples);
 
-    // Mix dry signal with phase inverted wet signal
-    wetSignalBuffer.applyGain(-1.0f);
-    wetSignalBuffer.addFrom(0, 0, drySignalBuffer, 0, 0, buffer.getNumSamples());
-    wetSignalBuffer.addFrom(1, 0, drySignalBuffer, 1, 0, buffer.getNumSamples());
+        FloatVectorOperations::clear(dryTap, numTaps);
+        FloatVectorOperations::clear(wetTap, numTaps);
 
-    bool bypass = apvts.getRawParameterValue("bypass")->load() > 0.5f;
+        analyzerFifo.push(dryTap, wetTap, numTaps);
+        idleTapSamples += numTaps;
+    }
+}
 
-    if (bypass) {
-        buffer.makeCopyOf(drySignalBuffer);
+template <typename SampleType>
+void Processor::accumulateLevels(const SampleType* samples, size_t numSamples, double& squaredSum, float& peak)
+{
+    // Both paths meter with this, so their readings are identical
+    for (size_t i = 0; i < numSamples; ++i) {
+        squaredSum += samples[i] * samples[i];
+        peak = jmax(peak, (float)std::abs(samples[i]));
+    }
+}
+
+template <typename SampleType>
+SampleType Processor::getPeakLevel(const dsp::AudioBlock<SampleType>& block)
+{
+    auto peak = (SampleType)0;
+
+    for (size_t channel = 0; channel < block.getNumChannels(); ++channel) {
+        const auto range = FloatVectorOperations::findMinAndMax(block.getChannelPointer(channel), (int)block.getNumSamples());
+        peak = jmax(peak, -range.getStart(), range.getEnd());
+    }
+
+    return peak;
+}
+
+template <typename SampleType>
+void Processor::addToMixdown(float* mixdown, const SampleType* samples, size_t numSamples, float gain, bool firstChannel)
+{
+    // Both paths mix down with this, so their taps are identical. The
+    // analyzer always works in float.
+    if (firstChannel) {
+        for (size_t i = 0; i < numSamples; ++i) {
+            mixdown[i] = (float)(gain * samples[i]);
+        }
     }
     else {
-		buffer.makeCopyOf(wetSignalBuffer);
-	}
+        for (size_t i = 0; i < numSamples; ++i) {
+            mixdown[i] += (float)(gain * samples[i]);
+        }
+    }
 }
 
+template void Processor::accumulateLevels<float>(const float*, size_t, double&, float&);
+template void Processor::accumulateLevels<double>(const double*, size_t, double&, float&);
+
 bool Processor::hasEditor() const
 {
     return true;
@@ -218,60 +924,39 @@ AudioProcessorValueTreeState::ParameterLayout Processor::createParameters()
     layout.add(std::make_unique<AudioParameterFloat>("threshold", "Threshold", NormalisableRange<float>(- 60.0f, 36.0f), -0.0f));
     layout.add(std::make_unique<AudioParameterFloat>("cutoff", "Cutoff", NormalisableRange<float>(20.0f, 20000.0f, 1.0f, 0.25f), 4000.0f));
     layout.add(std::make_unique<AudioParameterBool>("bypass", "Bypass", false));
+    layout.add(std::make_unique<AudioParameterFloat>("attack", "Attack", NormalisableRange<float>(0.1f, 200.0f, 0.01f, 0.3f), 20.0f));
+    layout.add(std::make_unique<AudioParameterFloat>("release", "Release", NormalisableRange<float>(1.0f, 2000.0f, 0.1f, 0.3f), 20.0f));
+    layout.add(std::make_unique<AudioParameterFloat>("ratio", "Ratio", NormalisableRange<float>(1.0f, 20.0f, 0.01f, 0.5f), 8.0f));
+    layout.add(std::make_unique<AudioParameterChoice>("detection", "Detection", StringArray { "Per channel", "Max linked", "Average linked", "Mid/side" }, 0));
+    layout.add(std::make_unique<AudioParameterChoice>("oversampling", "Oversampling", StringArray { "Off", "2x", "4x", "8x" }, 0));
+    layout.add(std::make_unique<AudioParameterChoice>("oversamplingMode", "Oversampling Mode", StringArray { "Polyphase IIR", "Linear phase FIR" }, 0));
+    layout.add(std::make_unique<AudioParameterFloat>("lookahead", "Lookahead", NormalisableRange<float>(0.0f, 10.0f, 0.01f), 0.0f));
+    layout.add(std::make_unique<AudioParameterChoice>("highpassMode", "Highpass Mode", StringArray { "IIR", "Linear phase" }, 0));
+    layout.add(std::make_unique<AudioParameterChoice>("modulationSource", "Modulation Source", StringArray { "Off", "LFO", "Envelope" }, 0));
+    layout.add(std::make_unique<AudioParameterFloat>("modulationDepth", "Modulation Depth", NormalisableRange<float>(-4.0f, 4.0f, 0.01f), 0.0f));
+    layout.add(std::make_unique<AudioParameterFloat>("modulationRate", "Modulation Rate", NormalisableRange<float>(0.01f, 20.0f, 0.01f, 0.3f), 1.0f));
 
     return layout;
 }
 
-float Processor::getRmsValue(bool drySignal)
+ProcessingStats& Processor::getProcessingStats()
 {
-    if (drySignal) {
-		return dryRmsValue;
-	}
-	else {
-		return wetRmsValue;
-	}
-}
-
-void Processor::pushNextDrySampleIntoFifo(float sample)
-{
-    if (dryFifoIndex == fftSize) {
-        if (!nextDryFFTBlockReady) {
-            zeromem(dryFftData, sizeof(dryFftData));
-            memcpy(dryFftData, dryFifo, sizeof(dryFifo));
-            nextDryFFTBlockReady = true;
-        }
-
-        dryFifoIndex = 0;
-    }
-
-    dryFifo[dryFifoIndex++] = sample;
+    return processingStats;
 }
 
-void Processor::pushNextWetSampleIntoFifo(float sample)
+void Processor::setAnalyzerEnabled(bool shouldBeEnabled)
 {
-    if (wetFifoIndex == fftSize) {
-        if (!nextWetFFTBlockReady) {
-            zeromem(wetFftData, sizeof(wetFftData));
-            memcpy(wetFftData, wetFifo, sizeof(wetFifo));
-            nextWetFFTBlockReady = true;
-        }
-
-        wetFifoIndex = 0;
-    }
-
-    wetFifo[wetFifoIndex++] = sample;
+    switches.analyzerEnabled.store(shouldBeEnabled);
 }
 
-void Processor::setCompressorThreshold(float threshold)
+void Processor::setMeteringEnabled(bool shouldBeEnabled)
 {
-	compressor.setThreshold(threshold);
+    switches.meteringEnabled.store(shouldBeEnabled);
 }
 
-void Processor::setFilterCutoff(float cutoff)
+void Processor::setFusedProcessing(bool shouldUseFusedKernel)
 {
-    for (int i = 0; i < numFilters; ++i) {
-        filter[i].setCutoffFrequency(cutoff);
-    }
+    switches.fusedProcessing.store(shouldUseFusedKernel);
 }
 
 AudioProcessor* JUCE_CALLTYPE createPluginFilter()
@@ -2,8 +2,17 @@
 
 #include <JuceHeader.h>
 #include <juce_audio_processors/juce_audio_processors.h>
+#include "AnalyzerFifo.h"
+#include "CacheLine.h"
+#include "Compressor.h"
+#include "CutoffModulator.h"
+#include "HighpassCascade.h"
+#include "LinearPhaseHighpass.h"
+#include "MeterFifo.h"
+#include "ProcessingStats.h"
+#include "RingDelay.h"
 
-class Processor final : public AudioProcessor
+class Processor final : public AudioProcessor, private Timer
 {
 public:
     Processor();
@@ -14,8 +23,10 @@ public:
 
     bool isBusesLayoutSupported (const BusesLayout& layouts) const override;
 
+    // Both precisions run the same chain, templated on the sample type
     void processBlock (AudioBuffer<float>&, MidiBuffer&) override;
-    using AudioProcessor::processBlock;
+    void processBlock (AudioBuffer<double>&, MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override;
 
     AudioProcessorEditor* createEditor() override;
     bool hasEditor() const override;
@@ -36,12 +47,14 @@ public:
     void getStateInformation (MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
 
-    float getRmsValue(bool);
-    void pushNextDrySampleIntoFifo(float);
-    void pushNextWetSampleIntoFifo(float);
+    // Adds the squares of the samples to the sum and raises the peak, as the
+    // meters measure every channel
+    template <typename SampleType>
+    static void accumulateLevels(const SampleType*, size_t, double&, float&);
 
-    void setCompressorThreshold(float);
-    void setFilterCutoff(float);
+    // The fused kernel runs the whole chain in a single pass, the multi-pass
+    // path stays as the reference it has to null against
+    void setFusedProcessing(bool);
 
     AudioProcessorValueTreeState::ParameterLayout createParameters();
     AudioProcessorValueTreeState apvts;
@@ -49,28 +62,230 @@ public:
     enum
     {
         fftOrder = 10,
-        fftSize = 1 << fftOrder
+        fftSize = 1 << fftOrder,
+        analyzerBlockSize = 128
     };
 
-    #include <vector>
+    // Analyzer taps handed from the audio thread to the spectrum engine. The
+    // taps are only written while an engine has enabled them.
+    using AnalyzerBlocks = AnalyzerFifo<analyzerBlockSize, 32>;
+    void setAnalyzerEnabled(bool);
 
-    float dryFifo[fftSize];
-    float wetFifo[fftSize];
-    float dryFftData[2 * fftSize];
-    float wetFftData[2 * fftSize];
-    int dryFifoIndex = 0;
-    int wetFifoIndex = 0;
-    bool nextDryFFTBlockReady = false;
-    bool nextWetFFTBlockReady = false;
+    template <typename Callback>
+    int popAnalyzerBlocks(Callback&& callback)
+    {
+        return analyzerFifo.popAll(std::forward<Callback>(callback));
+    }
+
+    // Peak, RMS and gain reduction of every processed chunk, handed from the
+    // audio thread to the editor. Readings are only pushed while enabled.
+    using MeterReadings = MeterFifo<1024>;
+    void setMeteringEnabled(bool);
+
+    template <typename Callback>
+    int popMeterReadings(Callback&& callback)
+    {
+        return meterFifo.popAll(std::forward<Callback>(callback));
+    }
+
+    // Callback load and per-stage timing, only measured while enabled
+    ProcessingStats& getProcessingStats();
 
 private:
-    float dryRmsValue = 0.0f;
-    float wetRmsValue = 0.0f;
+    void timerCallback() override;
+
+    void updateParameters();
+    void updateOversampling(int, int);
+    void updateLookahead(float);
+    void updateHighpassMode(int);
+    void updateLatency();
+    void advanceSmoothedParameters(size_t);
+    void pushAnalyzerTaps(float*, float*, size_t);
+    void pushMeterReading(const double*, const double*, float, float, size_t, size_t);
+    void pushIdleReadings(size_t);
+    void resetProcessingState();
+
+    template <typename SampleType>
+    void processSamples(AudioBuffer<SampleType>&);
+    template <typename SampleType>
+    void processChunkMultiPass(dsp::AudioBlock<SampleType>);
+    template <typename SampleType>
+    void mixChannel(SampleType*, const SampleType*, size_t, size_t) const;
+    template <typename SampleType>
+    void applyHighpass(const dsp::AudioBlock<SampleType>&, const dsp::AudioBlock<SampleType>&, float);
+    template <typename SampleType>
+    static void addToMixdown(float*, const SampleType*, size_t, float, bool);
+    template <typename SampleType>
+    static SampleType getPeakLevel(const dsp::AudioBlock<SampleType>&);
+
+    // The fused kernel for a fixed channel count, 0 takes the count from the
+    // block. prepareToPlay picks the one for the current layout.
+    template <typename SampleType, int>
+    void processChunkFused(dsp::AudioBlock<SampleType>);
+
+    // Mono, stereo and surround up to 7.1
+    constexpr static int maxNumChannels = 8;
+
+    // Parameters, cached so the audio thread never looks them up by name
+    std::atomic<float>* thresholdParameter = nullptr;
+    std::atomic<float>* cutoffParameter = nullptr;
+    std::atomic<float>* bypassParameter = nullptr;
+    std::atomic<float>* attackParameter = nullptr;
+    std::atomic<float>* releaseParameter = nullptr;
+    std::atomic<float>* ratioParameter = nullptr;
+    std::atomic<float>* detectionParameter = nullptr;
+    std::atomic<float>* oversamplingParameter = nullptr;
+    std::atomic<float>* oversamplingModeParameter = nullptr;
+    std::atomic<float>* lookaheadParameter = nullptr;
+    std::atomic<float>* highpassModeParameter = nullptr;
+    std::atomic<float>* modulationSourceParameter = nullptr;
+    std::atomic<float>* modulationDepthParameter = nullptr;
+    std::atomic<float>* modulationRateParameter = nullptr;
+
+    // Compression, filtering and the subtraction all run at the oversampled
+    // rate. Every factor and filter type is built in prepareToPlay, so
+    // switching between them on the audio thread never allocates.
+    constexpr static int maxOversamplingOrder = 3;
+    constexpr static int numOversamplingModes = 2;
+    int oversamplingOrder = -1;
+    int oversamplingMode = -1;
+    size_t oversamplingFactor = 1;
+
+    // The compressor detects on the undelayed input while the audio and the
+    // dry signal both go through the same lookahead delay
+    constexpr static double maxLookaheadTime = 0.01;
+    int lookaheadSamples = -1;
+
+    double baseSampleRate = 44100.0;
+    size_t maxChunkSize = 0;
+
+    // Threshold and cutoff move in steps once per sub-block, both paths take
+    // the steps of a chunk from these tables so they stay identical
+    constexpr static size_t parameterStepSize = 64;
+    SmoothedValue<float> smoothedThreshold;
+    SmoothedValue<float, ValueSmoothingTypes::Multiplicative> smoothedCutoff;
+    std::vector<float> thresholdSteps;
+    std::vector<float> cutoffSteps;
+
+    // Bypass fades between the processed and the dry signal per sample
+    SmoothedValue<float> bypassMix;
+    std::vector<float> bypassRamp;
+    bool bypassFading = false;
+    bool bypassed = false;
+
+    constexpr static double smoothingTime = 0.05;
+    constexpr static double bypassFadeTime = 0.02;
+
+    // Silent input keeps running through the chain for the hold, long enough
+    // to flush the delays and for the cascade to decay, and until both the
+    // output and the compressor envelopes are below the snap to zero floor.
+    // Then the chain goes idle. Idle callbacks clear the output and skip the
+    // chain, whose state was cleared for the next signal.
+    constexpr static double silenceThreshold = 1.0e-8;
+    int64 silentSamples = 0;
+    int silenceHoldSamples = 0;
+    int idleTapSamples = 0;
+    bool idle = false;
+
+    // The cascade at its lowest cutoff needs about 0.3 seconds to decay from
+    // full scale to the floor, the hold and the tail include this
+    constexpr static double maxDecayTime = 0.5;
+
+    // Analyzer taps collected before they are pushed into the analyzer fifo
+    AudioBuffer<float> tapBuffer;
+
+    // Analyzer taps for the fused kernel, collected per section
+    constexpr static size_t fusedSectionSize = 64;
+    static_assert(fusedSectionSize % Compressor::sectionSize == 0, "Both paths have to split the compressor input the same way");
+    static_assert(fusedSectionSize == parameterStepSize, "The fused kernel takes one parameter step per section");
+    float dryTapSection[fusedSectionSize];
+    float wetTapSection[fusedSectionSize];
+
+    // The gain computer, the modulation and the linear phase kernel run in
+    // float for both precisions
+    Compressor compressor;
+
+    // Moves the cutoff of the IIR cascade at audio rate, the cutoff stays
+    // below the range FastMath::tan is accurate in
+    CutoffModulator cutoffModulator;
+    float maxModulatedCutoff = 20000.0f;
+    constexpr static float minModulatedCutoff = 20.0f;
+
+    // The linear phase highpass delays the wet signal, the dry signal is
+    // delayed by the same amount before the subtraction
+    LinearPhaseHighpass linearPhaseHighpass;
+    int highpassMode = -1;
+    bool linearPhase = false;
+
+    // Everything that holds samples, once per precision. Only the chain of
+    // the current processing precision is prepared.
+    template <typename SampleType>
+    struct Chain
+    {
+        using ChunkKernel = void (Processor::*)(dsp::AudioBlock<SampleType>);
+
+        // Scratch bus for the dry signal, sized in prepareToPlay
+        AudioBuffer<SampleType> dryBuffer;
+
+        std::unique_ptr<dsp::Oversampling<SampleType>> oversamplers[numOversamplingModes][maxOversamplingOrder];
+        dsp::Oversampling<SampleType>* oversampling = nullptr;
+
+        RingDelay<SampleType> lookahead;
+        HighpassCascade<SampleType> highpass;
+        RingDelay<SampleType> linearPhaseDryDelay;
+
+        ChunkKernel fusedKernel = &Processor::processChunkFused<SampleType, 0>;
+    };
+
+    Chain<float> floatChain;
+    Chain<double> doubleChain;
+
+    template <typename SampleType>
+    Chain<SampleType>& getChain();
+
+    template <typename SampleType>
+    void prepareChain(Chain<SampleType>&, const dsp::ProcessSpec&);
+    template <typename SampleType>
+    void releaseChain(Chain<SampleType>&);
+
+    // Runs a generic lambda on the chain of the current processing precision
+    template <typename Function>
+    void forActiveChain(Function&& function)
+    {
+        if (isUsingDoublePrecision()) {
+            function(doubleChain);
+        }
+        else {
+            function(floatChain);
+        }
+    }
+
+    // Everything above belongs to the audio thread, and to prepareToPlay
+    // while it is stopped. What it shares with the editor follows, each part
+    // on cache lines of its own, so with many instances and an open editor
+    // no line the audio thread writes is also read by another core.
+
+    // Written by the editor, read once per block by the audio thread
+    struct alignas(cacheLineSize) Switches
+    {
+        std::atomic<bool> analyzerEnabled { false };
+        std::atomic<bool> meteringEnabled { false };
+        std::atomic<bool> fusedProcessing { true };
+    };
+
+    Switches switches;
+
+    // Written by the audio thread, drained by the spectrum engine and the editor
+    AnalyzerBlocks analyzerFifo;
+    MeterReadings meterFifo;
 
-    dsp::Compressor<float> compressor;
+    // Written by the audio thread when the latency changes, the latency is
+    // reported by the timer and the tail read by the host
+    std::atomic<int> latencySamples { 0 };
+    std::atomic<double> tailLengthSeconds { maxDecayTime };
 
-    const static int numFilters = 4;
-    dsp::StateVariableTPTFilter<float> filter[numFilters];
+    // Written by the audio thread, read by the diagnostics panel
+    ProcessingStats processingStats;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (Processor)
 };
@@ -0,0 +1,166 @@
+#include "ProcessingStats.h"
+
+const char* ProcessingStats::getStageName(int stage)
+{
+    switch (stage) {
+        case oversampling: return "Oversampling";
+        case compressor:   return "Compressor";
+        case highpass:     return "Highpass";
+        case taps:         return "Meters and taps";
+        case mix:          return "Mix";
+        default:           return "";
+    }
+}
+
+ProcessingStats::ProcessingStats()
+    : microsecondsPerTick(1.0e6 / (double)Time::getHighResolutionTicksPerSecond())
+{
+}
+
+void ProcessingStats::prepare(double newSampleRate, int newMaximumBlockSize)
+{
+    sampleRate = newSampleRate;
+    maximumBlockSize = newMaximumBlockSize;
+    loadMeasurer.reset(sampleRate, maximumBlockSize);
+    resetRequested.store(true);
+}
+
+void ProcessingStats::setEnabled(bool shouldBeEnabled)
+{
+    enabled.store(shouldBeEnabled);
+}
+
+void ProcessingStats::setRiskThreshold(float proportionOfDeadline)
+{
+    riskThreshold.store(jlimit(0.01f, 1.0f, proportionOfDeadline));
+}
+
+float ProcessingStats::getRiskThreshold() const
+{
+    return riskThreshold.load();
+}
+
+void ProcessingStats::reset()
+{
+    // The audio thread clears the figures at the start of its next callback
+    resetRequested.store(true);
+}
+
+ProcessingStats::Figures ProcessingStats::getCallbackFigures() const
+{
+    return callbackFigures.get();
+}
+
+ProcessingStats::Figures ProcessingStats::getStageFigures(int stage) const
+{
+    jassert(isPositiveAndBelow(stage, (int)numStages));
+    return stageFigures[stage].get();
+}
+
+int64 ProcessingStats::getNumCallbacks() const
+{
+    return numCallbacks.load(std::memory_order_relaxed);
+}
+
+int ProcessingStats::getNumRiskyCallbacks() const
+{
+    return numRiskyCallbacks.load(std::memory_order_relaxed);
+}
+
+double ProcessingStats::getLoad() const
+{
+    return loadMeasurer.getLoadAsProportion();
+}
+
+int ProcessingStats::getNumXRuns() const
+{
+    return loadMeasurer.getXRunCount();
+}
+
+void ProcessingStats::beginCallback() noexcept
+{
+    // Decided once per callback, so a callback is either timed completely or not at all
+    timing = enabled.load(std::memory_order_relaxed);
+
+    if (!timing) {
+        return;
+    }
+
+    // Only the rare reset writes to the line of the settings
+    if (resetRequested.load(std::memory_order_relaxed) && resetRequested.exchange(false)) {
+        clearFigures();
+    }
+
+    std::fill(std::begin(stageTicks), std::end(stageTicks), (int64)0);
+    callbackStartTicks = Time::getHighResolutionTicks();
+}
+
+void ProcessingStats::endCallback(int numSamples) noexcept
+{
+    if (!timing || numSamples <= 0) {
+        timing = false;
+        return;
+    }
+
+    const auto microseconds = (double)(Time::getHighResolutionTicks() - callbackStartTicks) * microsecondsPerTick;
+    const auto deadline = 1.0e6 * (double)numSamples / sampleRate;
+    const auto proportion = (float)(microseconds / deadline);
+
+    loadMeasurer.registerRenderTime(0.001 * microseconds, numSamples);
+
+    const auto count = numCallbacks.load(std::memory_order_relaxed) + 1;
+    callbackSum += proportion;
+    callbackFigures.add(proportion, callbackSum, count);
+
+    for (int stage = 0; stage < numStages; ++stage) {
+        const auto microseconds = (float)((double)stageTicks[stage] * microsecondsPerTick);
+        stageSums[stage] += microseconds;
+        stageFigures[stage].add(microseconds, stageSums[stage], count);
+    }
+
+    if (proportion > riskThreshold.load(std::memory_order_relaxed)) {
+        numRiskyCallbacks.store(numRiskyCallbacks.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    numCallbacks.store(count, std::memory_order_relaxed);
+    timing = false;
+}
+
+void ProcessingStats::clearFigures() noexcept
+{
+    loadMeasurer.reset(sampleRate, maximumBlockSize);
+    callbackFigures.clear();
+    callbackSum = 0.0;
+
+    for (int stage = 0; stage < numStages; ++stage) {
+        stageFigures[stage].clear();
+        stageSums[stage] = 0.0;
+    }
+
+    numCallbacks.store(0, std::memory_order_relaxed);
+    numRiskyCallbacks.store(0, std::memory_order_relaxed);
+}
+
+void ProcessingStats::PublishedFigures::clear() noexcept
+{
+    minimum.store(0.0f, std::memory_order_relaxed);
+    average.store(0.0f, std::memory_order_relaxed);
+    maximum.store(0.0f, std::memory_order_relaxed);
+}
+
+void ProcessingStats::PublishedFigures::add(float value, double sum, int64 count) noexcept
+{
+    // The first value of a run sets the minimum
+    minimum.store(count == 1 ? value : jmin(minimum.load(std::memory_order_relaxed), value), std::memory_order_relaxed);
+    maximum.store(jmax(maximum.load(std::memory_order_relaxed), value), std::memory_order_relaxed);
+    average.store((float)(sum / (double)count), std::memory_order_relaxed);
+}
+
+ProcessingStats::Figures ProcessingStats::PublishedFigures::get() const
+{
+    Figures figures;
+    figures.minimum = minimum.load(std::memory_order_relaxed);
+    figures.average = average.load(std::memory_order_relaxed);
+    figures.maximum = maximum.load(std::memory_order_relaxed);
+    return figures;
+}
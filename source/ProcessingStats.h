@@ -0,0 +1,131 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "CacheLine.h"
+#include "Tracing.h"
+
+// Opt-in timing of the audio callback and of every stage of the chain. The
+// audio thread is the only writer of the figures and publishes them through
+// relaxed atomics, so the editor reads them without ever blocking it. While
+// disabled, every timed stage costs a single branch. The settings, the audio
+// thread state and the published figures each start a cache line of their own.
+class alignas(cacheLineSize) ProcessingStats
+{
+public:
+    enum Stage
+    {
+        oversampling,
+        compressor,
+        highpass,
+        taps,
+        mix,
+        numStages
+    };
+
+    static const char* getStageName(int);
+
+    // Times one stage while a callback is being timed, and traces it in tracing builds
+    class ScopedStage
+    {
+    public:
+        ScopedStage(ProcessingStats& statsToUse, Stage stageToTime) noexcept
+            : stats(statsToUse)
+            , stage(stageToTime)
+            , startTicks(stats.timing ? Time::getHighResolutionTicks() : 0)
+           #if PLUGIN_TRACING
+            , traceEvent(getStageName(stageToTime))
+           #endif
+        {
+        }
+
+        ~ScopedStage() noexcept
+        {
+            if (stats.timing) {
+                stats.stageTicks[stage] += Time::getHighResolutionTicks() - startTicks;
+            }
+        }
+
+    private:
+        ProcessingStats& stats;
+        const Stage stage;
+        const int64 startTicks;
+
+       #if PLUGIN_TRACING
+        TraceRecorder::ScopedEvent traceEvent;
+       #endif
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedStage)
+    };
+
+    // Running figures since the last reset, in microseconds per callback for
+    // the stages and as a proportion of the block deadline for the callback
+    struct Figures
+    {
+        float minimum = 0.0f;
+        float average = 0.0f;
+        float maximum = 0.0f;
+    };
+
+    ProcessingStats();
+
+    // Called from prepareToPlay, resets everything
+    void prepare(double, int);
+
+    // Called from any thread
+    void setEnabled(bool);
+    void setRiskThreshold(float);
+    float getRiskThreshold() const;
+    void reset();
+
+    Figures getCallbackFigures() const;
+    Figures getStageFigures(int) const;
+    int64 getNumCallbacks() const;
+    int getNumRiskyCallbacks() const;
+
+    // Load and xruns as AudioProcessLoadMeasurer reports them
+    double getLoad() const;
+    int getNumXRuns() const;
+
+    // Called from the audio thread around every callback
+    void beginCallback() noexcept;
+    void endCallback(int) noexcept;
+
+private:
+    // Figures the editor reads, only written by the audio thread
+    struct PublishedFigures
+    {
+        std::atomic<float> minimum { 0.0f };
+        std::atomic<float> average { 0.0f };
+        std::atomic<float> maximum { 0.0f };
+
+        void clear() noexcept;
+        void add(float, double, int64) noexcept;
+        Figures get() const;
+    };
+
+    void clearFigures() noexcept;
+
+    // Written by the editor, read once per callback
+    alignas(cacheLineSize) std::atomic<bool> enabled { false };
+    std::atomic<bool> resetRequested { false };
+    std::atomic<float> riskThreshold { 0.75f };
+
+    // Audio thread state, set by prepare while the audio is stopped
+    alignas(cacheLineSize) double sampleRate = 44100.0;
+    int maximumBlockSize = 0;
+    double microsecondsPerTick = 0.0;
+    bool timing = false;
+    int64 callbackStartTicks = 0;
+    int64 stageTicks[numStages] = {};
+    double callbackSum = 0.0;
+    double stageSums[numStages] = {};
+
+    // Written by the audio thread, read by the editor
+    alignas(cacheLineSize) PublishedFigures callbackFigures;
+    PublishedFigures stageFigures[numStages];
+    std::atomic<int64> numCallbacks { 0 };
+    std::atomic<int> numRiskyCallbacks { 0 };
+    AudioProcessLoadMeasurer loadMeasurer;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ProcessingStats)
+};
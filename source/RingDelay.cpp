@@ -0,0 +1,90 @@
+#include "RingDelay.h"
+
+template <typename SampleType>
+void RingDelay<SampleType>::prepare(const dsp::ProcessSpec& spec, int maximumDelay)
+{
+    jassert(maximumDelay >= 0);
+
+    maxDelay = maximumDelay;
+    size = nextPowerOfTwo(maxDelay + (int)spec.maximumBlockSize);
+    mask = size - 1;
+
+    buffer.setSize((int)spec.numChannels, size);
+    setDelay(targetDelay);
+    reset();
+}
+
+template <typename SampleType>
+void RingDelay<SampleType>::reset()
+{
+    buffer.clear();
+    writePosition = 0;
+    delay = targetDelay;
+    fadeRemaining = 0;
+}
+
+template <typename SampleType>
+void RingDelay<SampleType>::setDelay(int newDelay)
+{
+    jassert(isPositiveAndNotGreaterThan(newDelay, maxDelay));
+
+    targetDelay = jlimit(0, maxDelay, newDelay);
+}
+
+template <typename SampleType>
+void RingDelay<SampleType>::process(const dsp::AudioBlock<const SampleType>& input, const dsp::AudioBlock<SampleType>& output)
+{
+    const auto numSamples = (int)output.getNumSamples();
+    const auto numChannels = (int)output.getNumChannels();
+
+    jassert(numChannels <= buffer.getNumChannels());
+    jassert(numSamples + maxDelay <= size);
+
+    if (fadeRemaining == 0 && targetDelay != delay) {
+        previousDelay = delay;
+        delay = targetDelay;
+        fadeRemaining = fadeLength;
+    }
+
+    // Write first, so a delay shorter than the block reads samples of this block
+    const auto readPosition = (writePosition - delay) & mask;
+    const auto firstWrite = jmin(numSamples, size - writePosition);
+    const auto firstRead = jmin(numSamples, size - readPosition);
+
+    for (int channel = 0; channel < numChannels; ++channel) {
+        const auto* in = input.getChannelPointer((size_t)channel);
+        auto* out = output.getChannelPointer((size_t)channel);
+        auto* ring = buffer.getWritePointer(channel);
+
+        FloatVectorOperations::copy(ring + writePosition, in, firstWrite);
+        FloatVectorOperations::copy(ring, in + firstWrite, numSamples - firstWrite);
+
+        FloatVectorOperations::copy(out, ring + readPosition, firstRead);
+        FloatVectorOperations::copy(out + firstRead, ring, numSamples - firstRead);
+    }
+
+    // Fade from the old read position to the new one
+    if (fadeRemaining > 0) {
+        const auto numFaded = jmin(numSamples, fadeRemaining);
+        const auto fadeStart = fadeLength - fadeRemaining;
+
+        for (int channel = 0; channel < numChannels; ++channel) {
+            auto* out = output.getChannelPointer((size_t)channel);
+            const auto* ring = buffer.getReadPointer(channel);
+
+            for (int i = 0; i < numFaded; ++i) {
+                const auto fade = (SampleType)(fadeStart + i + 1) / (SampleType)fadeLength;
+                const auto previous = ring[(writePosition - previousDelay + i) & mask];
+
+                out[i] = previous + fade * (out[i] - previous);
+            }
+        }
+
+        fadeRemaining -= numFaded;
+    }
+
+    writePosition = (writePosition + numSamples) & mask;
+}
+
+template class RingDelay<float>;
+template class RingDelay<double>;
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Multichannel delay line on a power-of-two ring buffer. A block is written
+// and read in at most two contiguous spans, split at the wrap point, so the
+// samples are moved with vector copies instead of per-sample index wrapping.
+// A new delay time is crossfaded in from the old one, so it can move while
+// audio runs without a click.
+template <typename SampleType>
+class RingDelay
+{
+public:
+    RingDelay() = default;
+
+    // Allocates room for the longest delay plus one block
+    void prepare(const dsp::ProcessSpec&, int);
+
+    // Clears the line and jumps straight to the requested delay
+    void reset();
+
+    // Fades to the new delay over fadeLength samples. A change during a fade
+    // waits until the fade has finished.
+    void setDelay(int);
+
+    // Writes the input into the delay line and reads the delayed signal into
+    // the output. The output may be the input block.
+    void process(const dsp::AudioBlock<const SampleType>&, const dsp::AudioBlock<SampleType>&);
+
+    constexpr static int fadeLength = 512;
+
+private:
+    AudioBuffer<SampleType> buffer;
+
+    int size = 0;
+    int mask = 0;
+    int maxDelay = 0;
+    int delay = 0;
+    int targetDelay = 0;
+    int previousDelay = 0;
+    int fadeRemaining = 0;
+    int writePosition = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RingDelay)
+};
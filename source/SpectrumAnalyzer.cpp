@@ -13,36 +13,20 @@ SpectrumAnalyzer::~SpectrumAnalyzer()
 
 void SpectrumAnalyzer::paint (Graphics& g)
 {
-    // Fill the background
-    g.setColour(Colour(0x18, 0x17, 0x1D));
-    g.fillRoundedRectangle(backgroundRect, cornerSize);
+    TRACE_SCOPE("SpectrumAnalyzer::paint");
 
-    // Draw grid lines for dB
-    for (int i = mindB + 12; i < maxdB; i += 12) {
-        float y = jmap<float>(i, mindB, maxdB, backgroundRect.getBottom(), backgroundRect.getY());
+    // The static layers follow the scale of the display the editor is on
+    const auto scale = g.getInternalContext().getPhysicalPixelScaleFactor();
 
-        if (i == 0) {
-            g.setColour(Colour::fromRGBA(0xFF, 0xFF, 0xFF, 0x40));
-        }
-        else {
-            g.setColour(Colour::fromRGBA(0xFF, 0xFF, 0xFF, 0x10));
-        }
-        g.drawLine(backgroundRect.getX(), y, backgroundRect.getRight(), y, 0.5 * strokeThickness);
+    if (scale != layerScale) {
+        layerScale = scale;
+        renderLayers();
     }
 
-    // Draw grid lines for Hz
-    for (int frequency : frequencies) {
-        float ratio = frequency / (samplerate / 2.0f);
-        float skewedProportion = 0.164f * std::log(443.158f * ratio + 1.0f);
-        float x = jmap<float>(skewedProportion, backgroundRect.getX(), backgroundRect.getRight());
-
-        g.setColour(Colour::fromRGBA(0xFF, 0xFF, 0xFF, 0x10));
-        g.drawLine(x, backgroundRect.getY(), x, backgroundRect.getBottom(), 0.5 * strokeThickness);
-    }
+    // Draw background and grid lines
+    backgroundLayer.draw(g);
 
     // Clip the component
-    Path clipRegion;
-    clipRegion.addRoundedRectangle(backgroundRect, cornerSize);
     g.saveState();
     g.reduceClipRegion(clipRegion);
 
@@ -106,30 +90,11 @@ void SpectrumAnalyzer::paint (Graphics& g)
         g.fillPath(wetSpectrumPath);
     }
 
-    // Draw Hz labels
-    for (int frequency: frequencies) {
-        float ratio = frequency / (samplerate / 2.0f);
-        float skewedProportion = 0.164f * std::log(443.158f * ratio + 1.0f);
-        float x = jmap<float>(skewedProportion, backgroundRect.getX(), backgroundRect.getRight());
-
-        // Draw the frequency labels
-        String text = String(frequency) + " Hz";
-        g.setColour(Colour(0xFF, 0xFF, 0xFF));
-        g.setFont(10.0f);
-        g.drawFittedText(text, Rectangle<int>(x - 25, backgroundRect.getBottom() - 20, 50, 20), Justification::centred, 1);
-    }
-
-    // Draw shadow and light for frame
-    PathStrokeType strokeType(5.0f * strokeThickness);
-    Path frame;
-    strokeType.createStrokedPath(frame, clipRegion);
-    shadow.drawForPath(g, frame);
-    light.drawForPath(g, frame);
+    // Draw Hz labels and the shadow and light for frame
+    overlayLayer.draw(g);
 
     // draw highpass cutoff line at y = 0 dB and x = cutoff frequency,  make it curve at cutoff and go down
-    float ratio = processorRef.apvts.getRawParameterValue("cutoff")->load() / (samplerate / 2.0f);
-    float skewedProportion = 0.164f * std::log(443.158f * ratio + 1.0f);
-    float x = jmap<float>(skewedProportion, backgroundRect.getX(), backgroundRect.getRight());
+    float x = getFrequencyPosition(processorRef.apvts.getRawParameterValue("cutoff")->load());
     float y = jmap<float>(0.0f, mindB, maxdB, backgroundRect.getBottom(), backgroundRect.getY());
 
     Path cutoffPath;
@@ -151,8 +116,7 @@ void SpectrumAnalyzer::paint (Graphics& g)
     g.strokePath(cutoffPath, PathStrokeType(strokeThickness));
 
     // Draw frame
-    g.setColour(Colour(0x18, 0x17, 0x1D));
-    g.fillPath(frame);
+    frameLayer.draw(g);
 
     g.restoreState();
 }
@@ -166,20 +130,92 @@ void SpectrumAnalyzer::resized()
 
     shadow = DropShadow(Colour::fromRGBA(0x00, 0x00, 0x00, 0x44), 5, Point<int>(5, 5));
     light = DropShadow(Colour::fromRGBA(0x48, 0x47, 0x4D, 0x20), 5, Point<int>(-5, -5));
+
+    // The clip region and the frame only change with the bounds
+    clipRegion.clear();
+    clipRegion.addRoundedRectangle(backgroundRect, cornerSize);
+    frame.clear();
+    PathStrokeType(5.0f * strokeThickness).createStrokedPath(frame, clipRegion);
+
+    layerScale = Component::getApproximateScaleFactorForComponent(this);
+    renderLayers();
 }
 
-void SpectrumAnalyzer::updateSpectra(float* dryFftData, float* wetFftData, float fftSize) {
-    for (int i = 0; i < scopeSize; i++) {
-        // Skew the spectrum
-        float ratio = i / (float)scopeSize;
-        float skewedProportion = (std::exp(ratio / 0.164f) - 1.0f) / 443.158f;
-        int fftDataIndex = jlimit<int>(0, roundToInt(fftSize / 2.0f - 1.0f), (skewedProportion * fftSize / 2.0f));
+void SpectrumAnalyzer::renderLayers()
+{
+    const auto area = getLocalBounds();
+
+    backgroundLayer.render(area, layerScale, [this](Graphics& g) {
+        // Fill the background
+        g.setColour(Colour(0x18, 0x17, 0x1D));
+        g.fillRoundedRectangle(backgroundRect, cornerSize);
+
+        // Draw grid lines for dB
+        for (int i = mindB + 12; i < maxdB; i += 12) {
+            float y = jmap<float>(i, mindB, maxdB, backgroundRect.getBottom(), backgroundRect.getY());
+
+            if (i == 0) {
+                g.setColour(Colour::fromRGBA(0xFF, 0xFF, 0xFF, 0x40));
+            }
+            else {
+                g.setColour(Colour::fromRGBA(0xFF, 0xFF, 0xFF, 0x10));
+            }
+            g.drawLine(backgroundRect.getX(), y, backgroundRect.getRight(), y, 0.5 * strokeThickness);
+        }
+
+        // Draw grid lines for Hz
+        for (int frequency : frequencies) {
+            float x = getFrequencyPosition((float)frequency);
+
+            g.setColour(Colour::fromRGBA(0xFF, 0xFF, 0xFF, 0x10));
+            g.drawLine(x, backgroundRect.getY(), x, backgroundRect.getBottom(), 0.5 * strokeThickness);
+        }
+    });
+
+    overlayLayer.render(area, layerScale, [this](Graphics& g) {
+        g.reduceClipRegion(clipRegion);
+
+        // Draw Hz labels
+        for (int frequency : frequencies) {
+            float x = getFrequencyPosition((float)frequency);
+
+            String text = String(frequency) + " Hz";
+            g.setColour(Colour(0xFF, 0xFF, 0xFF));
+            g.setFont(10.0f);
+            g.drawFittedText(text, Rectangle<int>(x - 25, backgroundRect.getBottom() - 20, 50, 20), Justification::centred, 1);
+        }
+
+        // Draw shadow and light for frame
+        shadow.drawForPath(g, frame);
+        light.drawForPath(g, frame);
+    });
 
-        float dryLevel = Decibels::gainToDecibels(dryFftData[fftDataIndex]) - Decibels::gainToDecibels(fftSize) + Decibels::gainToDecibels(512.0f) + i * 0.05f;
-        float wetLevel = Decibels::gainToDecibels(wetFftData[fftDataIndex]) - Decibels::gainToDecibels(fftSize) + Decibels::gainToDecibels(512.0f) + i * 0.05f;
+    frameLayer.render(area, layerScale, [this](Graphics& g) {
+        g.reduceClipRegion(clipRegion);
+        g.setColour(Colour(0x18, 0x17, 0x1D));
+        g.fillPath(frame);
+    });
+}
 
-        dryScopeData[i] = 0.5f * jlimit(mindB, maxdB, dryLevel) + 0.5f * dryScopeData[i];
-        wetScopeData[i] = 0.5f * jlimit(mindB, maxdB, wetLevel) + 0.5f * wetScopeData[i];
+float SpectrumAnalyzer::getFrequencyPosition(float frequency) const
+{
+    float ratio = frequency / (samplerate / 2.0f);
+    float skewedProportion = 0.164f * std::log(443.158f * ratio + 1.0f);
+    return jmap<float>(skewedProportion, backgroundRect.getX(), backgroundRect.getRight());
+}
+
+void SpectrumAnalyzer::updateSpectra(const float* dryLevels, const float* wetLevels) {
+    // The Hz grid moves with the sample rate, which may change while the editor is open
+    const int newSamplerate = (int)processorRef.getSampleRate();
+
+    if (newSamplerate != samplerate) {
+        samplerate = newSamplerate;
+        renderLayers();
+    }
+
+    for (int i = 0; i < scopeSize; i++) {
+        dryScopeData[i] = 0.5f * jlimit(mindB, maxdB, dryLevels[i]) + 0.5f * dryScopeData[i];
+        wetScopeData[i] = 0.5f * jlimit(mindB, maxdB, wetLevels[i]) + 0.5f * wetScopeData[i];
     }
 
     repaint();
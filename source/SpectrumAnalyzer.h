@@ -1,7 +1,9 @@
 #pragma once
 
 #include <JuceHeader.h>
+#include "CachedLayer.h"
 #include "PluginProcessor.h"
+#include "SpectrumEngine.h"
 
 class SpectrumAnalyzer  : public Component
 {
@@ -12,7 +14,7 @@ public:
     void paint (Graphics&) override;
     void resized() override;
 
-    void updateSpectra(float*, float*, float);
+    void updateSpectra(const float*, const float*);
 
     constexpr static float mindB = -60.0f;
     constexpr static float maxdB = 36.0f;
@@ -20,15 +22,28 @@ public:
     constexpr static float maxHz = 20000.0f;
 
 private:
+    // Renders the parts that do not change between frames
+    void renderLayers();
+    float getFrequencyPosition(float) const;
+
     Processor& processorRef;
 
     Rectangle<float> backgroundRect;
+    Path clipRegion;
+    Path frame;
+
+    // Background with the grid, the labels with the frame shadows, and the
+    // frame on top. Only the spectra and the cutoff are drawn every frame.
+    CachedLayer backgroundLayer;
+    CachedLayer overlayLayer;
+    CachedLayer frameLayer;
+    float layerScale = 1.0f;
 
     ColourGradient spectrumGradient;
     DropShadow shadow;
     DropShadow light;
 
-    const static int scopeSize = 512;
+    const static int scopeSize = SpectrumEngine::scopeSize;
     float dryScopeData[scopeSize];
     float wetScopeData[scopeSize];
 
@@ -0,0 +1,137 @@
+#include "SpectrumEngine.h"
+
+SpectrumEngine::SpectrumEngine(Processor& p)
+    : Thread("Spectrum analysis")
+    , processorRef(p)
+    , forwardFFT(Processor::fftOrder)
+    , window(Processor::fftSize, dsp::WindowingFunction<float>::hann)
+{
+    frequencyMap.prepare(numBins, scopeSize);
+
+    // Keep the calibration and the tilt the analyzer has always shown
+    for (int i = 0; i < scopeSize; ++i) {
+        levelOffsets[i] = Decibels::gainToDecibels(512.0f) - Decibels::gainToDecibels(16000.0f) + i * 0.05f;
+    }
+
+    // Drop whatever is left from a previous editor before enabling the taps
+    processorRef.popAnalyzerBlocks([](const Processor::AnalyzerBlocks::Block&) {});
+    processorRef.setAnalyzerEnabled(true);
+
+    startThread(Thread::Priority::low);
+}
+
+SpectrumEngine::~SpectrumEngine()
+{
+    processorRef.setAnalyzerEnabled(false);
+    stopThread(1000);
+}
+
+void SpectrumEngine::setHopSize(int newHopSize)
+{
+    jassert(newHopSize > 0 && newHopSize <= Processor::fftSize);
+    jassert(newHopSize % Processor::analyzerBlockSize == 0);
+
+    // Frames start at the boundary of an analyzer block
+    const auto limited = jlimit<int>(Processor::analyzerBlockSize, Processor::fftSize, newHopSize);
+    hopSize.store(limited - limited % Processor::analyzerBlockSize);
+}
+
+int SpectrumEngine::getHopSize() const
+{
+    return hopSize.load();
+}
+
+bool SpectrumEngine::getLatestSpectra(float* dryLevels, float* wetLevels)
+{
+    const SpinLock::ScopedLockType lock(publishLock);
+
+    if (!newSpectraAvailable) {
+        return false;
+    }
+
+    FloatVectorOperations::copy(dryLevels, publishedDryScopeData, scopeSize);
+    FloatVectorOperations::copy(wetLevels, publishedWetScopeData, scopeSize);
+    newSpectraAvailable = false;
+
+    return true;
+}
+
+void SpectrumEngine::run()
+{
+    while (!threadShouldExit()) {
+        processorRef.popAnalyzerBlocks([this](const Processor::AnalyzerBlocks::Block& block) {
+            appendBlock(block);
+        });
+
+        if (numFramesAveraged > 0) {
+            publishSpectra();
+        }
+
+        wait(pollIntervalMs);
+    }
+}
+
+void SpectrumEngine::appendBlock(const Processor::AnalyzerBlocks::Block& block)
+{
+    constexpr int blockSize = Processor::analyzerBlockSize;
+    constexpr int numKept = Processor::fftSize - blockSize;
+
+    // Slide the window along by one block
+    std::copy(dryHistory + blockSize, dryHistory + Processor::fftSize, dryHistory);
+    std::copy(wetHistory + blockSize, wetHistory + Processor::fftSize, wetHistory);
+    FloatVectorOperations::copy(dryHistory + numKept, block.dry, blockSize);
+    FloatVectorOperations::copy(wetHistory + numKept, block.wet, blockSize);
+
+    samplesInHistory = jmin(samplesInHistory + blockSize, (int)Processor::fftSize);
+    samplesSinceLastFrame += blockSize;
+
+    if (samplesInHistory == Processor::fftSize && samplesSinceLastFrame >= hopSize.load()) {
+        analyseFrame();
+        samplesSinceLastFrame = 0;
+    }
+}
+
+void SpectrumEngine::analyseFrame()
+{
+    TRACE_SCOPE("SpectrumEngine::analyseFrame");
+
+    for (auto* history : { dryHistory, wetHistory }) {
+        auto* powerSum = history == dryHistory ? dryPowerSum : wetPowerSum;
+
+        // Perform fft
+        FloatVectorOperations::copy(fftData, history, Processor::fftSize);
+        FloatVectorOperations::clear(fftData + Processor::fftSize, Processor::fftSize);
+        window.multiplyWithWindowingTable(fftData, Processor::fftSize);
+        forwardFFT.performFrequencyOnlyForwardTransform(fftData);
+
+        // Accumulate power for the average
+        for (int i = 0; i < numBins; ++i) {
+            powerSum[i] += fftData[i] * fftData[i];
+        }
+    }
+
+    ++numFramesAveraged;
+}
+
+void SpectrumEngine::publishSpectra()
+{
+    const auto scale = 1.0f / (float)numFramesAveraged;
+
+    // Average the frames in the power domain and map them to the scope
+    FloatVectorOperations::multiply(dryPowerSum, scale, numBins);
+    frequencyMap.process(dryPowerSum, dryScopeData);
+    FloatVectorOperations::add(dryScopeData, levelOffsets, scopeSize);
+
+    FloatVectorOperations::multiply(wetPowerSum, scale, numBins);
+    frequencyMap.process(wetPowerSum, wetScopeData);
+    FloatVectorOperations::add(wetScopeData, levelOffsets, scopeSize);
+
+    FloatVectorOperations::clear(dryPowerSum, numBins);
+    FloatVectorOperations::clear(wetPowerSum, numBins);
+    numFramesAveraged = 0;
+
+    const SpinLock::ScopedLockType lock(publishLock);
+    FloatVectorOperations::copy(publishedDryScopeData, dryScopeData, scopeSize);
+    FloatVectorOperations::copy(publishedWetScopeData, wetScopeData, scopeSize);
+    newSpectraAvailable = true;
+}
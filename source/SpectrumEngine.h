@@ -0,0 +1,70 @@
+#pragma once
+
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "LogFrequencyMap.h"
+
+// Background analysis worker for the spectrum analyzer. It only exists while
+// an editor is open: it enables the analyzer taps of the processor, builds
+// overlapping frames from the tapped blocks, averages their spectra and
+// publishes ready-to-draw levels for the message thread.
+class SpectrumEngine : private Thread
+{
+public:
+    explicit SpectrumEngine(Processor&);
+    ~SpectrumEngine() override;
+
+    // Samples between two analysed frames, a multiple of the analyzer block
+    // size up to the fft size. The default of fftSize / 4 gives 75% overlap,
+    // fftSize / 2 gives 50%. Safe to call while the engine runs.
+    void setHopSize(int);
+    int getHopSize() const;
+
+    // Copies the latest spectra in dB, returns false if nothing new was published
+    bool getLatestSpectra(float*, float*);
+
+    constexpr static int scopeSize = 512;
+
+private:
+    void run() override;
+
+    void appendBlock(const Processor::AnalyzerBlocks::Block&);
+    void analyseFrame();
+    void publishSpectra();
+
+    Processor& processorRef;
+
+    // FFT
+    dsp::FFT forwardFFT;
+    dsp::WindowingFunction<float> window;
+    float fftData[2 * Processor::fftSize];
+
+    // Sliding window over the tapped signal
+    float dryHistory[Processor::fftSize] = {};
+    float wetHistory[Processor::fftSize] = {};
+    int samplesInHistory = 0;
+    int samplesSinceLastFrame = 0;
+    std::atomic<int> hopSize { Processor::fftSize / 4 };
+
+    // Power of all frames analysed since the last publish
+    float dryPowerSum[Processor::fftSize] = {};
+    float wetPowerSum[Processor::fftSize] = {};
+    int numFramesAveraged = 0;
+
+    // Log-frequency mapping
+    constexpr static int numBins = Processor::fftSize / 2 + 1;
+    LogFrequencyMap frequencyMap;
+    float levelOffsets[scopeSize];
+    float dryScopeData[scopeSize];
+    float wetScopeData[scopeSize];
+
+    // Spectra handed to the message thread
+    SpinLock publishLock;
+    float publishedDryScopeData[scopeSize];
+    float publishedWetScopeData[scopeSize];
+    bool newSpectraAvailable = false;
+
+    constexpr static int pollIntervalMs = 5;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpectrumEngine)
+};
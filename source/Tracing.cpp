@@ -0,0 +1,204 @@
+#include "Tracing.h"
+
+#if PLUGIN_TRACING
+
+TraceRecorder& TraceRecorder::getInstance()
+{
+    static TraceRecorder instance;
+    return instance;
+}
+
+TraceRecorder::TraceRecorder()
+    : Thread("Trace writer")
+{
+}
+
+TraceRecorder::~TraceRecorder()
+{
+    stopCapture();
+}
+
+bool TraceRecorder::startCapture(const File& file, double seconds)
+{
+    const ScopedLock lock(captureLock);
+
+    if (isThreadRunning()) {
+        return false;
+    }
+
+    file.deleteFile();
+    stream = std::make_unique<FileOutputStream>(file);
+
+    if (!stream->openedOk()) {
+        stream.reset();
+        return false;
+    }
+
+    // Events are only recorded while capturing, so the buffers exist before
+    // any thread claims one. They are kept, a thread may still be writing.
+    for (auto& buffer : threadBuffers) {
+        if (buffer.events == nullptr) {
+            buffer.events.allocate((size_t)eventsPerThread, false);
+        }
+    }
+
+    captureSeconds = seconds;
+    firstEvent = true;
+    *stream << "{\"traceEvents\":[\n";
+
+    return startThread(Priority::low);
+}
+
+void TraceRecorder::stopCapture()
+{
+    const ScopedLock lock(captureLock);
+    stopThread(1000);
+}
+
+bool TraceRecorder::isCapturing() const noexcept
+{
+    return capturing.load(std::memory_order_relaxed);
+}
+
+void TraceRecorder::record(const char* name, int64 startTicks, int64 endTicks) noexcept
+{
+    auto* buffer = getThreadBuffer();
+
+    if (buffer == nullptr) {
+        return;
+    }
+
+    // A full buffer drops the event instead of waiting for the writer
+    const auto scope = buffer->fifo.write(1);
+
+    if (scope.blockSize1 == 0) {
+        buffer->numDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    buffer->events[scope.startIndex1] = { name, startTicks, endTicks };
+}
+
+TraceRecorder::ThreadBuffer* TraceRecorder::getThreadBuffer() noexcept
+{
+    // Claimed on the first event of a thread, which may be inside the
+    // allocation guard of the audio callback
+    thread_local ThreadBuffer* threadBuffer = nullptr;
+
+    if (threadBuffer == nullptr) {
+        const auto index = numThreadBuffers.fetch_add(1);
+
+        if (index >= maxNumThreads) {
+            numThreadBuffers.store(maxNumThreads);
+            return nullptr;
+        }
+
+        threadBuffer = &threadBuffers[index];
+        auto* name = threadBuffer->threadName;
+        const auto maxNameBytes = sizeof(threadBuffer->threadName);
+
+        if (MessageManager::existsAndIsCurrentThread()) {
+            std::snprintf(name, maxNameBytes, "Message thread");
+        }
+        else if (auto* thread = Thread::getCurrentThread()) {
+            // Copying the name only takes a reference
+            thread->getThreadName().copyToUTF8(name, maxNameBytes);
+        }
+        else {
+            // Threads JUCE did not start, which is where hosts call processBlock
+            std::snprintf(name, maxNameBytes, "Audio thread %d", index + 1);
+        }
+
+        threadBuffer->ready.store(true, std::memory_order_release);
+    }
+
+    return threadBuffer;
+}
+
+void TraceRecorder::run()
+{
+    // Whatever is left from a previous capture has stale timestamps
+    drain(false);
+
+    captureStartTicks = Time::getHighResolutionTicks();
+    capturing.store(true);
+
+    while (!threadShouldExit()) {
+        drain(true);
+
+        const auto elapsed = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - captureStartTicks);
+
+        if (captureSeconds > 0.0 && elapsed >= captureSeconds) {
+            break;
+        }
+
+        wait(flushIntervalMs);
+    }
+
+    capturing.store(false);
+    drain(true);
+
+    // Name the threads, and report what did not fit into their buffers
+    const auto numBuffers = jmin(numThreadBuffers.load(), (int)maxNumThreads);
+
+    for (int index = 0; index < numBuffers; ++index) {
+        auto& buffer = threadBuffers[index];
+
+        if (!buffer.ready.load(std::memory_order_acquire)) {
+            continue;
+        }
+
+        DynamicObject::Ptr args = new DynamicObject();
+        args->setProperty("name", String(CharPointer_UTF8(buffer.threadName)));
+        args->setProperty("dropped_events", buffer.numDropped.exchange(0));
+
+        writeEvent("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + String(index + 1)
+                   + ",\"args\":" + JSON::toString(var(args.get()), true) + "}");
+    }
+
+    *stream << "\n]}\n";
+    stream->flush();
+    stream.reset();
+}
+
+void TraceRecorder::drain(bool write)
+{
+    const auto numBuffers = jmin(numThreadBuffers.load(), (int)maxNumThreads);
+
+    for (int index = 0; index < numBuffers; ++index) {
+        auto& buffer = threadBuffers[index];
+
+        if (!buffer.ready.load(std::memory_order_acquire)) {
+            continue;
+        }
+
+        const auto scope = buffer.fifo.read(buffer.fifo.getNumReady());
+
+        if (!write) {
+            continue;
+        }
+
+        scope.forEach([&](int eventIndex) {
+            const auto& event = buffer.events[eventIndex];
+
+            // Complete events in microseconds since the start of the capture
+            const auto start = 1.0e6 * Time::highResolutionTicksToSeconds(event.startTicks - captureStartTicks);
+            const auto duration = 1.0e6 * Time::highResolutionTicksToSeconds(event.endTicks - event.startTicks);
+
+            writeEvent("{\"name\":\"" + String(event.name) + "\",\"ph\":\"X\",\"pid\":1,\"tid\":" + String(index + 1)
+                       + ",\"ts\":" + String(start, 3) + ",\"dur\":" + String(duration, 3) + "}");
+        });
+    }
+}
+
+void TraceRecorder::writeEvent(const String& json)
+{
+    if (!firstEvent) {
+        *stream << ",\n";
+    }
+
+    *stream << json;
+    firstEvent = false;
+}
+
+#endif
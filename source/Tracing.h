@@ -0,0 +1,112 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+// Timeline tracing of the audio, analysis and GUI threads, compiled in with
+// the ENABLE_TRACING CMake option. TRACE_SCOPE records how long the rest of
+// the enclosing scope takes, the name must be a string literal. Every thread
+// writes into its own lock-free ring buffer, and while a capture runs a
+// background thread drains them into a Chrome trace JSON file that
+// chrome://tracing and Perfetto open.
+#ifndef PLUGIN_TRACING
+ #define PLUGIN_TRACING 0
+#endif
+
+#if PLUGIN_TRACING
+
+class TraceRecorder : private Thread
+{
+public:
+    static TraceRecorder& getInstance();
+
+    ~TraceRecorder() override;
+
+    // Records every thread for the given number of seconds into the file, or
+    // until stopCapture for zero seconds. Returns false if a capture is
+    // already running or the file cannot be written.
+    bool startCapture(const File&, double);
+
+    // Ends a running capture early and waits until the file is complete
+    void stopCapture();
+
+    bool isCapturing() const noexcept;
+
+    class ScopedEvent
+    {
+    public:
+        explicit ScopedEvent(const char* eventName) noexcept
+            : name(eventName)
+            , startTicks(getInstance().isCapturing() ? Time::getHighResolutionTicks() : 0)
+        {
+        }
+
+        ~ScopedEvent() noexcept
+        {
+            if (startTicks != 0) {
+                getInstance().record(name, startTicks, Time::getHighResolutionTicks());
+            }
+        }
+
+    private:
+        const char* const name;
+        const int64 startTicks;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedEvent)
+    };
+
+private:
+    TraceRecorder();
+
+    struct Event
+    {
+        const char* name;
+        int64 startTicks;
+        int64 endTicks;
+    };
+
+    // Written by one thread only, read by the writer thread. The events are
+    // allocated by the first capture, before any thread can claim a buffer,
+    // and the name has a fixed size, so claiming never allocates.
+    struct ThreadBuffer
+    {
+        AbstractFifo fifo { eventsPerThread };
+        HeapBlock<Event> events;
+        std::atomic<int> numDropped { 0 };
+        std::atomic<bool> ready { false };
+        char threadName[64] = {};
+    };
+
+    void record(const char*, int64, int64) noexcept;
+    ThreadBuffer* getThreadBuffer() noexcept;
+
+    void run() override;
+    void drain(bool);
+    void writeEvent(const String&);
+
+    // Threads are never handed their buffer back, every editor that is
+    // opened starts another analysis thread
+    constexpr static int maxNumThreads = 64;
+    constexpr static int eventsPerThread = 1 << 14;
+    constexpr static int flushIntervalMs = 50;
+
+    ThreadBuffer threadBuffers[maxNumThreads];
+    std::atomic<int> numThreadBuffers { 0 };
+
+    std::atomic<bool> capturing { false };
+    CriticalSection captureLock;
+    std::unique_ptr<FileOutputStream> stream;
+    double captureSeconds = 0.0;
+    int64 captureStartTicks = 0;
+    bool firstEvent = true;
+
+    // No leak detector, the instance lives until static destruction
+    JUCE_DECLARE_NON_COPYABLE (TraceRecorder)
+};
+
+ #define TRACE_SCOPE(name) TraceRecorder::ScopedEvent JUCE_JOIN_MACRO (traceEvent, __LINE__) (name)
+
+#else
+
+ #define TRACE_SCOPE(name)
+
+#endif
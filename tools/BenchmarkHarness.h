@@ -0,0 +1,150 @@
+#pragma once
+
+#include <JuceHeader.h>
+
+#include <iostream>
+
+// Minimal timing harness for the benchmark tools. Every benchmark is
+// calibrated to run for a minimum time, measured over a number of runs and
+// reported by its median, so results are stable enough to compare between
+// builds. Results are collected as JSON.
+class BenchmarkHarness
+{
+public:
+    BenchmarkHarness(double minSecondsPerRun, int numRuns)
+        : minSeconds(minSecondsPerRun)
+        , runs(jmax(1, numRuns))
+    {
+    }
+
+    // Only benchmarks whose name contains this are run
+    void setFilter(const String& newFilter)
+    {
+        filter = newFilter;
+    }
+
+    // Times a single iteration of the function. Parameters are reported with
+    // the result; samplesPerIteration and sampleRate give the per-sample time
+    // and realtime factor when the iteration processes audio.
+    template <typename Function>
+    void run(const String& name, const NamedValueSet& parameters, int samplesPerIteration, double sampleRate, Function&& function)
+    {
+        if (filter.isNotEmpty() && !name.containsIgnoreCase(filter)) {
+            return;
+        }
+
+        // Warm up and estimate how many iterations fill a run
+        int64 iterations = 1;
+
+        for (;;) {
+            const auto elapsed = time(function, iterations);
+
+            if (elapsed >= minSeconds * 0.1 || iterations >= ((int64)1 << 40)) {
+                iterations = jmax((int64)1, (int64)std::ceil((double)iterations * minSeconds / jmax(elapsed, 1.0e-9)));
+                break;
+            }
+
+            iterations *= 10;
+        }
+
+        std::vector<double> nanosecondsPerIteration;
+
+        for (int i = 0; i < runs; ++i) {
+            nanosecondsPerIteration.push_back(time(function, iterations) * 1.0e9 / (double)iterations);
+        }
+
+        std::sort(nanosecondsPerIteration.begin(), nanosecondsPerIteration.end());
+        const auto median = nanosecondsPerIteration[nanosecondsPerIteration.size() / 2];
+
+        auto* result = new DynamicObject();
+        result->setProperty("name", name);
+
+        for (auto& parameter : parameters) {
+            result->setProperty(parameter.name, parameter.value);
+        }
+
+        result->setProperty("iterations", iterations);
+        result->setProperty("runs", runs);
+        result->setProperty("median_ns", median);
+        result->setProperty("min_ns", nanosecondsPerIteration.front());
+        result->setProperty("max_ns", nanosecondsPerIteration.back());
+
+        if (samplesPerIteration > 0) {
+            result->setProperty("ns_per_sample", median / samplesPerIteration);
+        }
+
+        if (samplesPerIteration > 0 && sampleRate > 0.0) {
+            result->setProperty("realtime_factor", (double)samplesPerIteration / sampleRate * 1.0e9 / median);
+        }
+
+        results.add(var(result));
+
+        // Progress goes to stderr so stdout can be piped as JSON
+        std::cerr << name << describe(parameters) << ": " << String(median, 1) << " ns" << std::endl;
+    }
+
+    // Information about the machine and the build, every tool adds its own
+    // settings to it
+    static DynamicObject::Ptr createContext()
+    {
+        DynamicObject::Ptr context = new DynamicObject();
+        context->setProperty("date", Time::getCurrentTime().toISO8601(true));
+        context->setProperty("version", ProjectInfo::versionString);
+        context->setProperty("juce", SystemStats::getJUCEVersion());
+        context->setProperty("os", SystemStats::getOperatingSystemName());
+        context->setProperty("cpu", SystemStats::getCpuModel());
+        context->setProperty("num_cpus", SystemStats::getNumCpus());
+        context->setProperty("num_physical_cpus", SystemStats::getNumPhysicalCpus());
+       #if JUCE_DEBUG
+        context->setProperty("build", "debug");
+       #else
+        context->setProperty("build", "release");
+       #endif
+
+        return context;
+    }
+
+    // All results with information about the machine and the build
+    var toJson() const
+    {
+        auto context = createContext();
+        context->setProperty("min_seconds_per_run", minSeconds);
+
+        auto* root = new DynamicObject();
+        root->setProperty("context", var(context.get()));
+        root->setProperty("benchmarks", results);
+
+        return var(root);
+    }
+
+private:
+    template <typename Function>
+    static double time(Function& function, int64 iterations)
+    {
+        const auto startTicks = Time::getHighResolutionTicks();
+
+        for (int64 i = 0; i < iterations; ++i) {
+            function();
+        }
+
+        return Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks);
+    }
+
+    static String describe(const NamedValueSet& parameters)
+    {
+        StringArray pairs;
+
+        for (auto& parameter : parameters) {
+            pairs.add(parameter.name.toString() + "=" + parameter.value.toString());
+        }
+
+        return pairs.isEmpty() ? String() : " [" + pairs.joinIntoString(", ") + "]";
+    }
+
+    double minSeconds;
+    int runs;
+    String filter;
+    Array<var> results;
+
+    JUCE_DECLARE_NON_COPYABLE (BenchmarkHarness)
+};
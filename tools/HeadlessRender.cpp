@@ -0,0 +1,395 @@
+#include <JuceHeader.h>
+#include "PluginProcessor.h"
+#include "Tracing.h"
+
+#include <iostream>
+
+// Streams a file or a generated test signal through Processor::processBlock
+// without a host, writes the result and reports how long the callbacks took.
+namespace
+{
+    struct Options
+    {
+        File inputFile;
+        File outputFile;
+        String signal = "noise";
+        double sampleRate = 48000.0;
+        int blockSize = 512;
+        int numChannels = 2;
+        double seconds = 10.0;
+        bool fused = true;
+        bool nullTest = false;
+        File traceFile;
+        double traceSeconds = 0.0;
+        StringPairArray parameters;
+    };
+
+    struct RenderResult
+    {
+        AudioBuffer<float> output;
+        std::vector<double> callbackSeconds;
+        double totalSeconds = 0.0;
+    };
+
+    void printUsage()
+    {
+        std::cout << "Usage: HeadlessRender [options]" << std::endl
+                  << "  --input=<file>          WAV or AIFF file to process" << std::endl
+                  << "  --signal=<type>         noise, sine or drums when no input is given (default noise)" << std::endl
+                  << "  --seconds=<n>           length of the generated signal (default 10)" << std::endl
+                  << "  --output=<file>         write the processed audio as WAV or AIFF" << std::endl
+                  << "  --sample-rate=<hz>      processing sample rate (default 48000 or the file rate)" << std::endl
+                  << "  --block-size=<n>        samples per callback (default 512)" << std::endl
+                  << "  --channels=<n>          channel count (default 2)" << std::endl
+                  << "  --param=<id>=<value>    set a parameter, may be repeated" << std::endl
+                  << "  --multipass             use the multi-pass reference path" << std::endl
+                  << "  --null-test             check the fused kernel against the multi-pass path" << std::endl
+                  << "  --trace=<file>          write a Chrome trace of the render, needs ENABLE_TRACING" << std::endl
+                  << "  --trace-seconds=<n>     only trace the first n seconds of wall-clock time" << std::endl;
+    }
+
+    AudioBuffer<float> generateSignal(const String& type, int numChannels, int numSamples, double sampleRate)
+    {
+        AudioBuffer<float> signal(numChannels, numSamples);
+        signal.clear();
+        Random random(1234);
+
+        for (int channel = 0; channel < numChannels; ++channel) {
+            auto* samples = signal.getWritePointer(channel);
+
+            if (type == "sine") {
+                // A different partial on each channel
+                const auto frequency = 110.0 * (channel + 1);
+
+                for (int i = 0; i < numSamples; ++i) {
+                    samples[i] = 0.5f * (float)std::sin(MathConstants<double>::twoPi * frequency * i / sampleRate);
+                }
+            }
+            else if (type == "drums") {
+                // Alternating kicks and noise snares at 120 bpm
+                const auto beatLength = (int)(sampleRate * 0.5);
+
+                for (int i = 0; i < numSamples; ++i) {
+                    const auto beat = i / beatLength;
+                    const auto time = (double)(i % beatLength) / sampleRate;
+
+                    if (beat % 2 == 0) {
+                        samples[i] = 0.9f * (float)(std::exp(-time * 20.0) * std::sin(MathConstants<double>::twoPi * 55.0 * time));
+                    }
+                    else {
+                        samples[i] = 0.6f * (float)std::exp(-time * 35.0) * (2.0f * random.nextFloat() - 1.0f);
+                    }
+                }
+            }
+            else {
+                for (int i = 0; i < numSamples; ++i) {
+                    samples[i] = 0.5f * (2.0f * random.nextFloat() - 1.0f);
+                }
+            }
+        }
+
+        return signal;
+    }
+
+    bool readFile(const File& file, AudioBuffer<float>& buffer, double& sampleRate)
+    {
+        AudioFormatManager formatManager;
+        formatManager.registerBasicFormats();
+
+        std::unique_ptr<AudioFormatReader> reader(formatManager.createReaderFor(file));
+
+        if (reader == nullptr) {
+            return false;
+        }
+
+        buffer.setSize((int)reader->numChannels, (int)reader->lengthInSamples);
+        reader->read(&buffer, 0, buffer.getNumSamples(), 0, true, true);
+        sampleRate = reader->sampleRate;
+
+        return true;
+    }
+
+    bool writeFile(const File& file, const AudioBuffer<float>& buffer, double sampleRate)
+    {
+        AudioFormatManager formatManager;
+        formatManager.registerBasicFormats();
+
+        auto* format = formatManager.findFormatForFileExtension(file.getFileExtension());
+
+        if (format == nullptr) {
+            return false;
+        }
+
+        file.deleteFile();
+        std::unique_ptr<OutputStream> stream(file.createOutputStream());
+
+        if (stream == nullptr) {
+            return false;
+        }
+
+        std::unique_ptr<AudioFormatWriter> writer(format->createWriterFor(stream.get(), sampleRate, (unsigned int)buffer.getNumChannels(), 24, {}, 0));
+
+        if (writer == nullptr) {
+            return false;
+        }
+
+        // The writer owns the stream now
+        stream.release();
+
+        return writer->writeFromAudioSampleBuffer(buffer, 0, buffer.getNumSamples());
+    }
+
+    bool prepareProcessor(Processor& processor, const Options& options)
+    {
+        const auto channelSet = AudioChannelSet::canonicalChannelSet(options.numChannels);
+        AudioProcessor::BusesLayout layout;
+        layout.inputBuses.add(channelSet);
+        layout.outputBuses.add(channelSet);
+
+        if (!processor.setBusesLayout(layout)) {
+            std::cerr << "Unsupported channel count: " << options.numChannels << std::endl;
+            return false;
+        }
+
+        // Parameters are applied before prepareToPlay so the DSP starts from them
+        for (auto& id : options.parameters.getAllKeys()) {
+            auto* parameter = processor.apvts.getParameter(id);
+
+            if (parameter == nullptr) {
+                std::cerr << "Unknown parameter: " << id << std::endl;
+                return false;
+            }
+
+            const auto value = options.parameters[id].getFloatValue();
+            parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+        }
+
+        processor.setFusedProcessing(options.fused);
+        processor.setRateAndBufferSizeDetails(options.sampleRate, options.blockSize);
+        processor.prepareToPlay(options.sampleRate, options.blockSize);
+
+        return true;
+    }
+
+    bool render(const AudioBuffer<float>& input, const Options& options, RenderResult& result)
+    {
+        Processor processor;
+
+        if (!prepareProcessor(processor, options)) {
+            return false;
+        }
+
+        const auto numSamples = input.getNumSamples();
+        const auto numCallbacks = (numSamples + options.blockSize - 1) / options.blockSize;
+
+        AudioBuffer<float> blockBuffer(options.numChannels, options.blockSize);
+        MidiBuffer midiMessages;
+
+        result.output.setSize(options.numChannels, numSamples);
+        result.callbackSeconds.clear();
+        result.callbackSeconds.reserve((size_t)numCallbacks);
+        result.totalSeconds = 0.0;
+
+        for (int startSample = 0; startSample < numSamples; startSample += options.blockSize) {
+            const auto numBlockSamples = jmin(options.blockSize, numSamples - startSample);
+
+            for (int channel = 0; channel < options.numChannels; ++channel) {
+                blockBuffer.copyFrom(channel, 0, input, channel % input.getNumChannels(), startSample, numBlockSamples);
+            }
+
+            // The last callback may be shorter, like it can be in a host
+            AudioBuffer<float> callbackBuffer(blockBuffer.getArrayOfWritePointers(), options.numChannels, numBlockSamples);
+
+            const auto startTicks = Time::getHighResolutionTicks();
+            processor.processBlock(callbackBuffer, midiMessages);
+            const auto elapsed = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks);
+
+            result.callbackSeconds.push_back(elapsed);
+            result.totalSeconds += elapsed;
+
+            for (int channel = 0; channel < options.numChannels; ++channel) {
+                result.output.copyFrom(channel, startSample, callbackBuffer, channel, 0, numBlockSamples);
+            }
+        }
+
+        processor.releaseResources();
+        return true;
+    }
+
+    void printReport(const RenderResult& result, const Options& options)
+    {
+        auto sorted = result.callbackSeconds;
+        std::sort(sorted.begin(), sorted.end());
+
+        auto percentile = [&sorted](double proportion) {
+            const auto index = jmin(sorted.size() - 1, (size_t)(proportion * (double)sorted.size()));
+            return sorted[index] * 1.0e6;
+        };
+
+        const auto worst = std::max_element(result.callbackSeconds.begin(), result.callbackSeconds.end());
+        const auto audioSeconds = (double)result.output.getNumSamples() / options.sampleRate;
+        const auto deadline = (double)options.blockSize / options.sampleRate;
+
+        std::cout << "Rendered " << audioSeconds << " s at " << options.sampleRate << " Hz, "
+                  << options.numChannels << " channels, " << options.blockSize << " samples per block ("
+                  << (options.fused ? "fused" : "multi-pass") << ")" << std::endl;
+        std::cout << "Realtime factor: " << audioSeconds / result.totalSeconds << "x" << std::endl;
+        std::cout << "Callback p50: " << percentile(0.5) << " us, p99: " << percentile(0.99)
+                  << " us, max: " << sorted.back() * 1.0e6 << " us" << std::endl;
+        std::cout << "Worst callback: #" << std::distance(result.callbackSeconds.begin(), worst)
+                  << " at " << 100.0 * *worst / deadline << "% of the " << deadline * 1.0e3 << " ms deadline" << std::endl;
+    }
+
+    float getPeakDifference(const AudioBuffer<float>& a, const AudioBuffer<float>& b)
+    {
+        float peak = 0.0f;
+
+        for (int channel = 0; channel < a.getNumChannels(); ++channel) {
+            const auto* samplesA = a.getReadPointer(channel);
+            const auto* samplesB = b.getReadPointer(channel);
+
+            for (int i = 0; i < a.getNumSamples(); ++i) {
+                peak = jmax(peak, std::abs(samplesA[i] - samplesB[i]));
+            }
+        }
+
+        return peak;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    ScopedJuceInitialiser_GUI juceInitialiser;
+    ArgumentList args(argc, argv);
+
+    if (args.containsOption("--help|-h")) {
+        printUsage();
+        return 0;
+    }
+
+    Options options;
+
+    for (auto& argument : args.arguments) {
+        if (argument.isLongOption("param")) {
+            const auto assignment = argument.getLongOptionValue();
+            options.parameters.set(assignment.upToFirstOccurrenceOf("=", false, false), assignment.fromFirstOccurrenceOf("=", false, false));
+        }
+    }
+
+    if (args.containsOption("--input")) {
+        options.inputFile = args.getExistingFileForOption("--input");
+    }
+
+    if (args.containsOption("--output")) {
+        options.outputFile = args.getFileForOption("--output");
+    }
+
+    if (args.containsOption("--signal")) {
+        options.signal = args.getValueForOption("--signal");
+    }
+
+    if (args.containsOption("--seconds")) {
+        options.seconds = args.getValueForOption("--seconds").getDoubleValue();
+    }
+
+    if (args.containsOption("--block-size")) {
+        options.blockSize = args.getValueForOption("--block-size").getIntValue();
+    }
+
+    if (args.containsOption("--channels")) {
+        options.numChannels = args.getValueForOption("--channels").getIntValue();
+    }
+
+    options.fused = !args.containsOption("--multipass");
+    options.nullTest = args.containsOption("--null-test");
+
+    if (args.containsOption("--trace")) {
+        options.traceFile = args.getFileForOption("--trace");
+    }
+
+    if (args.containsOption("--trace-seconds")) {
+        options.traceSeconds = args.getValueForOption("--trace-seconds").getDoubleValue();
+    }
+
+   #if !PLUGIN_TRACING
+    if (options.traceFile != File()) {
+        std::cerr << "Tracing is not compiled in, configure with -DENABLE_TRACING=ON" << std::endl;
+        return 1;
+    }
+   #endif
+
+    // Read or generate the input
+    AudioBuffer<float> input;
+
+    if (options.inputFile != File()) {
+        if (!readFile(options.inputFile, input, options.sampleRate)) {
+            std::cerr << "Could not read " << options.inputFile.getFullPathName() << std::endl;
+            return 1;
+        }
+    }
+
+    if (args.containsOption("--sample-rate")) {
+        options.sampleRate = args.getValueForOption("--sample-rate").getDoubleValue();
+    }
+
+    if (options.blockSize <= 0 || options.numChannels <= 0 || options.sampleRate <= 0.0) {
+        printUsage();
+        return 1;
+    }
+
+    if (options.inputFile == File()) {
+        input = generateSignal(options.signal, options.numChannels, (int)(options.seconds * options.sampleRate), options.sampleRate);
+    }
+
+    if (input.getNumSamples() == 0) {
+        std::cerr << "Nothing to render" << std::endl;
+        return 1;
+    }
+
+    RenderResult result;
+
+   #if PLUGIN_TRACING
+    // Only the first render is traced, the null test reference is not
+    if (options.traceFile != File() && !TraceRecorder::getInstance().startCapture(options.traceFile, options.traceSeconds)) {
+        std::cerr << "Could not write " << options.traceFile.getFullPathName() << std::endl;
+        return 1;
+    }
+   #endif
+
+    const auto rendered = render(input, options, result);
+
+   #if PLUGIN_TRACING
+    TraceRecorder::getInstance().stopCapture();
+   #endif
+
+    if (!rendered) {
+        return 1;
+    }
+
+    printReport(result, options);
+
+    if (options.outputFile != File() && !writeFile(options.outputFile, result.output, options.sampleRate)) {
+        std::cerr << "Could not write " << options.outputFile.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    if (options.nullTest) {
+        // Render again on the other path and compare the outputs
+        auto referenceOptions = options;
+        referenceOptions.fused = !options.fused;
+        RenderResult reference;
+
+        if (!render(input, referenceOptions, reference)) {
+            return 1;
+        }
+
+        const auto peakDifference = getPeakDifference(result.output, reference.output);
+        std::cout << "Null test: peak difference " << Decibels::gainToDecibels(peakDifference, -200.0f) << " dB" << std::endl;
+
+        if (peakDifference > 0.0f) {
+            return 2;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,268 @@
+#include <JuceHeader.h>
+#include "BenchmarkHarness.h"
+#include "PluginProcessor.h"
+
+#include <iostream>
+#include <thread>
+
+// Runs a growing number of processor instances at once, each on an audio
+// thread of its own with an editor-like thread that keeps draining its meter
+// readings and analyzer taps, and reports how the throughput of one instance
+// holds up as instances are added. State that two threads write on the same
+// cache line shows up as a scaling efficiency well below one.
+namespace
+{
+    struct Options
+    {
+        double sampleRate = 48000.0;
+        int blockSize = 128;
+        double seconds = 2.0;
+        int maxInstances = SystemStats::getNumPhysicalCpus();
+        bool editors = true;
+        int pollIntervalMs = 0;
+    };
+
+    struct Instance
+    {
+        Processor processor;
+        AudioBuffer<float> input;
+        AudioBuffer<float> buffer;
+
+        // Written by the audio thread, read when the measurement starts and ends
+        alignas(cacheLineSize) std::atomic<int64> numCallbacks { 0 };
+    };
+
+    struct StepResult
+    {
+        int numInstances = 0;
+        double minimumRealtimeFactor = 0.0;
+        double averageRealtimeFactor = 0.0;
+        double maximumRealtimeFactor = 0.0;
+    };
+
+    void printUsage()
+    {
+        std::cout << "Usage: InstanceStress [options]" << std::endl
+                  << "  --output=<file>           write the JSON results to a file instead of stdout" << std::endl
+                  << "  --max-instances=<n>       largest instance count (default the physical cores)" << std::endl
+                  << "  --seconds=<n>             measured time of each step (default 2)" << std::endl
+                  << "  --sample-rate=<hz>        processing sample rate (default 48000)" << std::endl
+                  << "  --block-size=<n>          samples per callback (default 128)" << std::endl
+                  << "  --poll-interval=<ms>      pause of the editor threads between polls (default 0)" << std::endl
+                  << "  --no-editors              run the audio threads alone" << std::endl;
+    }
+
+    void prepareInstance(Instance& instance, const Options& options)
+    {
+        Random random(1234);
+
+        instance.input.setSize(2, options.blockSize);
+        instance.buffer.setSize(2, options.blockSize);
+
+        for (int channel = 0; channel < 2; ++channel) {
+            for (int i = 0; i < options.blockSize; ++i) {
+                instance.input.setSample(channel, i, 0.5f * (2.0f * random.nextFloat() - 1.0f));
+            }
+        }
+
+        instance.processor.setAnalyzerEnabled(options.editors);
+        instance.processor.setMeteringEnabled(options.editors);
+        instance.processor.setRateAndBufferSizeDetails(options.sampleRate, options.blockSize);
+        instance.processor.prepareToPlay(options.sampleRate, options.blockSize);
+    }
+
+    void runAudio(Instance& instance, const std::atomic<bool>& stop)
+    {
+        ScopedNoDenormals noDenormals;
+        MidiBuffer midiMessages;
+
+        while (!stop.load(std::memory_order_relaxed)) {
+            // Fresh input on every call, like a host
+            for (int channel = 0; channel < 2; ++channel) {
+                instance.buffer.copyFrom(channel, 0, instance.input, channel, 0, instance.input.getNumSamples());
+            }
+
+            instance.processor.processBlock(instance.buffer, midiMessages);
+            instance.numCallbacks.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void runEditor(Instance& instance, const std::atomic<bool>& stop, int pollIntervalMs)
+    {
+        // Polls far more often than a real editor, so any shared line is hit hard
+        while (!stop.load(std::memory_order_relaxed)) {
+            instance.processor.popMeterReadings([](const Processor::MeterReadings::Reading&) {});
+            instance.processor.popAnalyzerBlocks([](const Processor::AnalyzerBlocks::Block&) {});
+            instance.processor.getProcessingStats().getCallbackFigures();
+
+            if (pollIntervalMs > 0) {
+                Thread::sleep(pollIntervalMs);
+            }
+            else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    StepResult runStep(int numInstances, const Options& options)
+    {
+        std::vector<std::unique_ptr<Instance>> instances;
+
+        for (int i = 0; i < numInstances; ++i) {
+            instances.push_back(std::make_unique<Instance>());
+            prepareInstance(*instances.back(), options);
+        }
+
+        std::atomic<bool> stop { false };
+        std::vector<std::thread> threads;
+
+        for (auto& instance : instances) {
+            threads.emplace_back(runAudio, std::ref(*instance), std::cref(stop));
+
+            if (options.editors) {
+                threads.emplace_back(runEditor, std::ref(*instance), std::cref(stop), options.pollIntervalMs);
+            }
+        }
+
+        // Let every thread get going before measuring
+        Thread::sleep(200);
+
+        std::vector<int64> startCallbacks;
+
+        for (auto& instance : instances) {
+            startCallbacks.push_back(instance->numCallbacks.load());
+        }
+
+        const auto startTicks = Time::getHighResolutionTicks();
+        Thread::sleep(roundToInt(options.seconds * 1000.0));
+        const auto elapsed = Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks);
+
+        StepResult result;
+        result.numInstances = numInstances;
+        result.minimumRealtimeFactor = std::numeric_limits<double>::max();
+
+        for (size_t i = 0; i < instances.size(); ++i) {
+            const auto numCallbacks = instances[i]->numCallbacks.load() - startCallbacks[i];
+            const auto realtimeFactor = (double)numCallbacks * options.blockSize / options.sampleRate / elapsed;
+
+            result.minimumRealtimeFactor = jmin(result.minimumRealtimeFactor, realtimeFactor);
+            result.maximumRealtimeFactor = jmax(result.maximumRealtimeFactor, realtimeFactor);
+            result.averageRealtimeFactor += realtimeFactor / numInstances;
+        }
+
+        stop.store(true);
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        for (auto& instance : instances) {
+            instance->processor.releaseResources();
+        }
+
+        return result;
+    }
+
+    var toJson(const std::vector<StepResult>& results, const Options& options)
+    {
+        auto context = BenchmarkHarness::createContext();
+        context->setProperty("sample_rate", options.sampleRate);
+        context->setProperty("block_size", options.blockSize);
+        context->setProperty("seconds_per_step", options.seconds);
+        context->setProperty("editors", options.editors);
+        context->setProperty("poll_interval_ms", options.pollIntervalMs);
+        context->setProperty("cache_line_padding", PLUGIN_CACHE_LINE_PADDING != 0);
+        context->setProperty("cache_line_size", (int)cacheLineSize);
+
+        Array<var> steps;
+
+        for (auto& result : results) {
+            auto* step = new DynamicObject();
+            step->setProperty("instances", result.numInstances);
+            step->setProperty("min_realtime_factor", result.minimumRealtimeFactor);
+            step->setProperty("avg_realtime_factor", result.averageRealtimeFactor);
+            step->setProperty("max_realtime_factor", result.maximumRealtimeFactor);
+
+            // How much of the single instance throughput every instance keeps
+            step->setProperty("scaling_efficiency", result.averageRealtimeFactor / results.front().averageRealtimeFactor);
+            steps.add(var(step));
+        }
+
+        auto* root = new DynamicObject();
+        root->setProperty("context", var(context.get()));
+        root->setProperty("steps", steps);
+
+        return var(root);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    ScopedJuceInitialiser_GUI juceInitialiser;
+    ArgumentList args(argc, argv);
+
+    if (args.containsOption("--help|-h")) {
+        printUsage();
+        return 0;
+    }
+
+    Options options;
+
+    if (args.containsOption("--max-instances")) {
+        options.maxInstances = args.getValueForOption("--max-instances").getIntValue();
+    }
+
+    if (args.containsOption("--seconds")) {
+        options.seconds = args.getValueForOption("--seconds").getDoubleValue();
+    }
+
+    if (args.containsOption("--sample-rate")) {
+        options.sampleRate = args.getValueForOption("--sample-rate").getDoubleValue();
+    }
+
+    if (args.containsOption("--block-size")) {
+        options.blockSize = args.getValueForOption("--block-size").getIntValue();
+    }
+
+    if (args.containsOption("--poll-interval")) {
+        options.pollIntervalMs = args.getValueForOption("--poll-interval").getIntValue();
+    }
+
+    options.editors = !args.containsOption("--no-editors");
+
+    if (options.maxInstances <= 0 || options.blockSize <= 0 || options.sampleRate <= 0.0 || options.seconds <= 0.0) {
+        printUsage();
+        return 1;
+    }
+
+    // Doubling the instances up to the limit, and the limit itself
+    std::vector<StepResult> results;
+
+    for (int numInstances = 1;; numInstances = jmin(2 * numInstances, options.maxInstances)) {
+        results.push_back(runStep(numInstances, options));
+
+        // Progress goes to stderr so stdout can be piped as JSON
+        std::cerr << numInstances << " instances: " << String(results.back().averageRealtimeFactor, 1)
+                  << "x realtime each" << std::endl;
+
+        if (numInstances == options.maxInstances) {
+            break;
+        }
+    }
+
+    const auto json = JSON::toString(toJson(results, options));
+
+    if (args.containsOption("--output")) {
+        const auto outputFile = args.getFileForOption("--output");
+
+        if (!outputFile.replaceWithText(json)) {
+            std::cerr << "Could not write " << outputFile.getFullPathName() << std::endl;
+            return 1;
+        }
+    }
+    else {
+        std::cout << json << std::endl;
+    }
+
+    return 0;
+}
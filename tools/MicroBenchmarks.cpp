@@ -0,0 +1,433 @@
+#include <JuceHeader.h>
+#include "BenchmarkHarness.h"
+#include "Compressor.h"
+#include "CutoffModulator.h"
+#include "LinearPhaseHighpass.h"
+#include "LogFrequencyMap.h"
+#include "PluginProcessor.h"
+#include "SpectrumAnalyzer.h"
+#include "SpectrumEngine.h"
+
+// Times every stage of the processing chain and of the analyzer path on its
+// own, over a sweep of block sizes and sample rates, and prints the results
+// as JSON for comparing builds.
+namespace
+{
+    const std::vector<int> allBlockSizes = { 16, 32, 64, 128, 256, 512, 1024, 2048, 4096 };
+    const std::vector<double> allSampleRates = { 44100.0, 48000.0, 88200.0, 96000.0, 176400.0, 192000.0 };
+
+    const std::vector<int> quickBlockSizes = { 64, 512, 4096 };
+    const std::vector<double> quickSampleRates = { 48000.0, 192000.0 };
+
+    constexpr int numChannels = 2;
+
+    template <typename SampleType>
+    void fillWithNoise(AudioBuffer<SampleType>& buffer)
+    {
+        Random random(1234);
+
+        for (int channel = 0; channel < buffer.getNumChannels(); ++channel) {
+            auto* samples = buffer.getWritePointer(channel);
+
+            for (int i = 0; i < buffer.getNumSamples(); ++i) {
+                samples[i] = (SampleType)(0.5f * (2.0f * random.nextFloat() - 1.0f));
+            }
+        }
+    }
+
+    NamedValueSet makeParameters(int blockSize, double sampleRate)
+    {
+        NamedValueSet parameters;
+        parameters.set("block_size", blockSize);
+        parameters.set("sample_rate", sampleRate);
+        return parameters;
+    }
+
+    template <typename SampleType>
+    NamedValueSet makeParameters(int blockSize, double sampleRate)
+    {
+        auto parameters = makeParameters(blockSize, sampleRate);
+        parameters.set("precision", std::is_same<SampleType, double>::value ? "double" : "float");
+        return parameters;
+    }
+
+    template <typename SampleType>
+    void copyInput(AudioBuffer<SampleType>& buffer, const AudioBuffer<SampleType>& input)
+    {
+        for (int channel = 0; channel < buffer.getNumChannels(); ++channel) {
+            buffer.copyFrom(channel, 0, input, channel, 0, buffer.getNumSamples());
+        }
+    }
+
+    // Compressing the same buffer over and over would push it below the
+    // threshold, so the compressors get fresh input on every iteration
+    template <typename SampleType>
+    void benchmarkCompressor(BenchmarkHarness& harness, int blockSize, double sampleRate)
+    {
+        AudioBuffer<SampleType> input(numChannels, blockSize);
+        AudioBuffer<SampleType> buffer(numChannels, blockSize);
+        fillWithNoise(input);
+
+        Compressor compressor;
+        compressor.prepare({ sampleRate, (uint32)blockSize, (uint32)numChannels });
+        compressor.setThreshold(-20.0f);
+        compressor.setRatio(8.0f);
+        compressor.setAttack(20.0f);
+        compressor.setRelease(20.0f);
+
+        dsp::AudioBlock<SampleType> block(buffer);
+
+        harness.run("compressor", makeParameters<SampleType>(blockSize, sampleRate), blockSize, sampleRate, [&] {
+            copyInput(buffer, input);
+            compressor.process(block);
+            compressor.snapToZero();
+        });
+    }
+
+    // The JUCE compressor the plugin used before, as a baseline
+    void benchmarkJuceCompressor(BenchmarkHarness& harness, int blockSize, double sampleRate)
+    {
+        AudioBuffer<float> input(numChannels, blockSize);
+        AudioBuffer<float> buffer(numChannels, blockSize);
+        fillWithNoise(input);
+
+        dsp::Compressor<float> compressor;
+        compressor.prepare({ sampleRate, (uint32)blockSize, (uint32)numChannels });
+        compressor.setThreshold(-20.0f);
+        compressor.setRatio(8.0f);
+        compressor.setAttack(20.0f);
+        compressor.setRelease(20.0f);
+
+        dsp::AudioBlock<float> block(buffer);
+
+        harness.run("juceCompressor", makeParameters(blockSize, sampleRate), blockSize, sampleRate, [&] {
+            copyInput(buffer, input);
+            compressor.process(dsp::ProcessContextReplacing<float>(block));
+        });
+    }
+
+    // The filter keeps the level of the noise it is run over, so it can
+    // process its buffer in place. Double precision fills half as many lanes.
+    template <typename SampleType>
+    void benchmarkHighpass(BenchmarkHarness& harness, int blockSize, double sampleRate)
+    {
+        AudioBuffer<SampleType> buffer(numChannels, blockSize);
+        fillWithNoise(buffer);
+
+        HighpassCascade<SampleType> highpass;
+        highpass.prepare({ sampleRate, (uint32)blockSize, (uint32)numChannels });
+        highpass.setCutoffFrequency(1000.0f);
+
+        dsp::AudioBlock<SampleType> block(buffer);
+
+        harness.run("highpassCascade", makeParameters<SampleType>(blockSize, sampleRate), blockSize, sampleRate, [&] {
+            highpass.process(block);
+            highpass.snapToZero();
+        });
+    }
+
+    // LFO modulation ramps the coefficients every modulation step, it should
+    // stay within about 1.5 times the cost of the static filter
+    void benchmarkModulatedHighpass(BenchmarkHarness& harness, int blockSize, double sampleRate)
+    {
+        AudioBuffer<float> buffer(numChannels, blockSize);
+        fillWithNoise(buffer);
+
+        HighpassCascade<float> highpass;
+        highpass.prepare({ sampleRate, (uint32)blockSize, (uint32)numChannels });
+        highpass.setCutoffFrequency(1000.0f);
+
+        CutoffModulator modulator;
+        modulator.prepare(sampleRate);
+        modulator.setSource(CutoffModulator::Source::lfo);
+        modulator.setDepth(2.0f);
+        modulator.setRate(5.0f);
+
+        dsp::AudioBlock<float> block(buffer);
+
+        harness.run("highpassCascadeModulated", makeParameters(blockSize, sampleRate), blockSize, sampleRate, [&] {
+            for (size_t startSample = 0; startSample < block.getNumSamples(); startSample += CutoffModulator::stepSize) {
+                const auto step = block.getSubBlock(startSample, jmin(CutoffModulator::stepSize, block.getNumSamples() - startSample));
+                highpass.process(step, 1000.0f * modulator.getNextMultiplier(step));
+            }
+
+            highpass.snapToZero();
+        });
+    }
+
+    // The kernel length is fixed, so the cost per sample should not depend on the sample rate
+    void benchmarkLinearPhaseHighpass(BenchmarkHarness& harness, int blockSize, double sampleRate)
+    {
+        AudioBuffer<float> buffer(numChannels, blockSize);
+        fillWithNoise(buffer);
+
+        LinearPhaseHighpass highpass;
+        highpass.setCutoffFrequency(1000.0f);
+        highpass.prepare({ sampleRate, (uint32)blockSize, (uint32)numChannels });
+
+        dsp::AudioBlock<float> block(buffer);
+
+        harness.run("linearPhaseHighpass", makeParameters(blockSize, sampleRate), blockSize, sampleRate, [&] {
+            highpass.process(block);
+        });
+    }
+
+    void benchmarkRms(BenchmarkHarness& harness, int blockSize, double sampleRate)
+    {
+        AudioBuffer<float> buffer(numChannels, blockSize);
+        fillWithNoise(buffer);
+
+        volatile float sink = 0.0f;
+
+        // Peak and RMS over all channels, as the processor meters every chunk
+        harness.run("rms", makeParameters(blockSize, sampleRate), blockSize, sampleRate, [&] {
+            auto squaredSum = 0.0;
+            auto peak = 0.0f;
+
+            for (int channel = 0; channel < numChannels; ++channel) {
+                Processor::accumulateLevels(buffer.getReadPointer(channel), (size_t)blockSize, squaredSum, peak);
+            }
+
+            sink = peak + (float)std::sqrt(squaredSum / (double)(numChannels * blockSize));
+        });
+    }
+
+    void benchmarkAnalyzerFifo(BenchmarkHarness& harness, int blockSize, double sampleRate)
+    {
+        AudioBuffer<float> buffer(numChannels, blockSize);
+        fillWithNoise(buffer);
+
+        // The fifo holds less than the largest block, so the block is pushed
+        // in chunks that are drained right away and never drop
+        constexpr int chunkSize = 1024;
+        auto fifo = std::make_unique<Processor::AnalyzerBlocks>();
+        volatile float sink = 0.0f;
+
+        harness.run("analyzerFifo", makeParameters(blockSize, sampleRate), blockSize, sampleRate, [&] {
+            for (int startSample = 0; startSample < blockSize; startSample += chunkSize) {
+                const auto numSamples = jmin(chunkSize, blockSize - startSample);
+
+                fifo->push(buffer.getReadPointer(0, startSample), buffer.getReadPointer(1, startSample), numSamples);
+                fifo->popAll([&sink](const Processor::AnalyzerBlocks::Block& analyzerBlock) {
+                    sink = analyzerBlock.dry[0] + analyzerBlock.wet[0];
+                });
+            }
+        });
+    }
+
+    void setParameter(Processor& processor, const String& parameterID, float value)
+    {
+        auto* parameter = processor.apvts.getParameter(parameterID);
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+    }
+
+    template <typename SampleType>
+    void benchmarkProcessBlock(BenchmarkHarness& harness, int blockSize, double sampleRate, bool fused, bool analyzer,
+                               int channels = numChannels, int oversamplingOrder = 0, int oversamplingMode = 0)
+    {
+        AudioBuffer<SampleType> input(channels, blockSize);
+        AudioBuffer<SampleType> buffer(channels, blockSize);
+        fillWithNoise(input);
+        MidiBuffer midiMessages;
+
+        Processor processor;
+
+        // The layout picks the fused kernel in prepareToPlay
+        const auto channelSet = AudioChannelSet::canonicalChannelSet(channels);
+        AudioProcessor::BusesLayout layout;
+        layout.inputBuses.add(channelSet);
+        layout.outputBuses.add(channelSet);
+        processor.setBusesLayout(layout);
+
+        setParameter(processor, "oversampling", (float)oversamplingOrder);
+        setParameter(processor, "oversamplingMode", (float)oversamplingMode);
+
+        processor.setFusedProcessing(fused);
+        processor.setAnalyzerEnabled(analyzer);
+        processor.setProcessingPrecision(std::is_same<SampleType, double>::value ? AudioProcessor::doublePrecision
+                                                                                 : AudioProcessor::singlePrecision);
+        processor.setRateAndBufferSizeDetails(sampleRate, blockSize);
+        processor.prepareToPlay(sampleRate, blockSize);
+
+        auto parameters = makeParameters<SampleType>(blockSize, sampleRate);
+        parameters.set("path", fused ? "fused" : "multipass");
+        parameters.set("analyzer", analyzer);
+        parameters.set("channels", channels);
+        parameters.set("oversampling", 1 << oversamplingOrder);
+        parameters.set("oversampling_mode", oversamplingMode == 0 ? "iir" : "fir");
+
+        // Fresh input on every call, like a host
+        harness.run("processBlock", parameters, blockSize, sampleRate, [&] {
+            copyInput(buffer, input);
+
+            processor.processBlock(buffer, midiMessages);
+
+            if (analyzer) {
+                processor.popAnalyzerBlocks([](const Processor::AnalyzerBlocks::Block&) {});
+            }
+        });
+
+        processor.releaseResources();
+    }
+
+    void benchmarkFft(BenchmarkHarness& harness)
+    {
+        dsp::FFT forwardFFT(Processor::fftOrder);
+        dsp::WindowingFunction<float> window(Processor::fftSize, dsp::WindowingFunction<float>::hann);
+
+        AudioBuffer<float> input(1, Processor::fftSize);
+        fillWithNoise(input);
+        std::vector<float> fftData(2 * Processor::fftSize);
+
+        NamedValueSet parameters;
+        parameters.set("fft_size", (int)Processor::fftSize);
+
+        // One frame of one spectrum, as the spectrum engine analyses it
+        harness.run("fftWithWindow", parameters, Processor::fftSize, 0.0, [&] {
+            FloatVectorOperations::copy(fftData.data(), input.getReadPointer(0), Processor::fftSize);
+            FloatVectorOperations::clear(fftData.data() + Processor::fftSize, Processor::fftSize);
+            window.multiplyWithWindowingTable(fftData.data(), Processor::fftSize);
+            forwardFFT.performFrequencyOnlyForwardTransform(fftData.data());
+        });
+    }
+
+    void benchmarkFrequencyMap(BenchmarkHarness& harness)
+    {
+        constexpr int numBins = Processor::fftSize / 2 + 1;
+
+        LogFrequencyMap frequencyMap;
+        frequencyMap.prepare(numBins, SpectrumEngine::scopeSize);
+
+        std::vector<float> powers(numBins);
+        std::vector<float> levels(SpectrumEngine::scopeSize);
+        Random random(1234);
+
+        for (auto& power : powers) {
+            power = random.nextFloat();
+        }
+
+        for (auto aggregation : { LogFrequencyMap::Aggregation::maximum, LogFrequencyMap::Aggregation::powerAverage }) {
+            frequencyMap.setAggregation(aggregation);
+
+            NamedValueSet parameters;
+            parameters.set("scope_size", SpectrumEngine::scopeSize);
+            parameters.set("aggregation", aggregation == LogFrequencyMap::Aggregation::maximum ? "maximum" : "powerAverage");
+
+            harness.run("logFrequencyMap", parameters, 0, 0.0, [&] {
+                frequencyMap.process(powers.data(), levels.data());
+            });
+        }
+    }
+
+    void benchmarkUpdateSpectra(BenchmarkHarness& harness)
+    {
+        Processor processor;
+        SpectrumAnalyzer analyzer(processor);
+
+        std::vector<float> dryLevels(SpectrumEngine::scopeSize);
+        std::vector<float> wetLevels(SpectrumEngine::scopeSize);
+        Random random(1234);
+
+        for (int i = 0; i < SpectrumEngine::scopeSize; ++i) {
+            dryLevels[(size_t)i] = jmap(random.nextFloat(), -80.0f, 40.0f);
+            wetLevels[(size_t)i] = jmap(random.nextFloat(), -80.0f, 40.0f);
+        }
+
+        NamedValueSet parameters;
+        parameters.set("scope_size", SpectrumEngine::scopeSize);
+
+        harness.run("updateSpectra", parameters, 0, 0.0, [&] {
+            analyzer.updateSpectra(dryLevels.data(), wetLevels.data());
+        });
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    ScopedJuceInitialiser_GUI juceInitialiser;
+    ScopedNoDenormals noDenormals;
+    ArgumentList args(argc, argv);
+
+    if (args.containsOption("--help|-h")) {
+        std::cout << "Usage: MicroBenchmarks [options]" << std::endl
+                  << "  --output=<file>     write the JSON results to a file instead of stdout" << std::endl
+                  << "  --filter=<text>     only run benchmarks whose name contains the text" << std::endl
+                  << "  --min-time=<s>      minimum time of each run (default 0.1)" << std::endl
+                  << "  --runs=<n>          runs per benchmark, the median is reported (default 5)" << std::endl
+                  << "  --quick             sweep fewer block sizes and sample rates" << std::endl;
+        return 0;
+    }
+
+    const auto quick = args.containsOption("--quick");
+    const auto minTime = args.containsOption("--min-time") ? args.getValueForOption("--min-time").getDoubleValue() : (quick ? 0.02 : 0.1);
+    const auto numRuns = args.containsOption("--runs") ? args.getValueForOption("--runs").getIntValue() : 5;
+
+    BenchmarkHarness harness(minTime, numRuns);
+
+    if (args.containsOption("--filter")) {
+        harness.setFilter(args.getValueForOption("--filter"));
+    }
+
+    const auto& blockSizes = quick ? quickBlockSizes : allBlockSizes;
+    const auto& sampleRates = quick ? quickSampleRates : allSampleRates;
+
+    for (auto sampleRate : sampleRates) {
+        for (auto blockSize : blockSizes) {
+            benchmarkCompressor<float>(harness, blockSize, sampleRate);
+            benchmarkCompressor<double>(harness, blockSize, sampleRate);
+            benchmarkJuceCompressor(harness, blockSize, sampleRate);
+            benchmarkHighpass<float>(harness, blockSize, sampleRate);
+            benchmarkHighpass<double>(harness, blockSize, sampleRate);
+            benchmarkModulatedHighpass(harness, blockSize, sampleRate);
+            benchmarkLinearPhaseHighpass(harness, blockSize, sampleRate);
+
+            for (auto fused : { true, false }) {
+                for (auto analyzer : { false, true }) {
+                    benchmarkProcessBlock<float>(harness, blockSize, sampleRate, fused, analyzer);
+                }
+
+                // The same chain in double precision, as hosts that ask for it run it
+                benchmarkProcessBlock<double>(harness, blockSize, sampleRate, fused, false);
+
+                // Mono and the surround layouts
+                for (auto channels : { 1, 6, 8 }) {
+                    benchmarkProcessBlock<float>(harness, blockSize, sampleRate, fused, false, channels);
+                }
+
+                // Every oversampling factor, the cost should scale with it
+                for (int order = 1; order <= 3; ++order) {
+                    for (int mode = 0; mode < 2; ++mode) {
+                        benchmarkProcessBlock<float>(harness, blockSize, sampleRate, fused, false, numChannels, order, mode);
+                    }
+                }
+            }
+        }
+    }
+
+    // These do not depend on the sample rate
+    for (auto blockSize : blockSizes) {
+        benchmarkRms(harness, blockSize, sampleRates.front());
+        benchmarkAnalyzerFifo(harness, blockSize, sampleRates.front());
+    }
+
+    // Analyzer path, once per frame
+    benchmarkFft(harness);
+    benchmarkFrequencyMap(harness);
+    benchmarkUpdateSpectra(harness);
+
+    const auto json = JSON::toString(harness.toJson());
+
+    if (args.containsOption("--output")) {
+        const auto outputFile = args.getFileForOption("--output");
+
+        if (!outputFile.replaceWithText(json)) {
+            std::cerr << "Could not write " << outputFile.getFullPathName() << std::endl;
+            return 1;
+        }
+    }
+    else {
+        std::cout << json << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,586 @@
+#include <JuceHeader.h>
+#include "BenchmarkHarness.h"
+#include "PluginProcessor.h"
+
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#if JUCE_LINUX
+ #include <unistd.h>
+#elif JUCE_MAC
+ #include <mach/mach.h>
+#elif JUCE_WINDOWS
+ #include <windows.h>
+ #include <psapi.h>
+#endif
+
+// Renders a host-like graph of many processor instances: tracks with a chain
+// of instances each, all summed into a master bus. Every graph cycle is one
+// block, and the nodes run on a work-stealing thread pool the way host worker
+// threads run them, with the thread that starts a cycle as the first worker.
+// Reports the throughput of the whole graph, how it scales with the number of
+// workers, the tail latency of a graph cycle and the memory every instance
+// adds.
+namespace
+{
+    struct Options
+    {
+        int numInstances = 128;
+        int chainLength = 2;
+        int maxWorkers = SystemStats::getNumCpus();
+        int numChannels = 2;
+        int blockSize = 128;
+        double sampleRate = 48000.0;
+        int numCycles = 2000;
+    };
+
+    AudioProcessor::BusesLayout getLayout(int numChannels)
+    {
+        const auto channelSet = AudioChannelSet::canonicalChannelSet(numChannels);
+        AudioProcessor::BusesLayout layout;
+        layout.inputBuses.add(channelSet);
+        layout.outputBuses.add(channelSet);
+
+        return layout;
+    }
+
+    // Resident memory of the process, 0 where it cannot be read
+    int64 getResidentBytes()
+    {
+       #if JUCE_LINUX
+        // The second field is the resident page count
+        const auto fields = StringArray::fromTokens(File("/proc/self/statm").loadFileAsString(), " ", "");
+
+        if (fields.size() < 2) {
+            return 0;
+        }
+
+        return fields[1].getLargeIntValue() * (int64)sysconf(_SC_PAGESIZE);
+       #elif JUCE_MAC
+        mach_task_basic_info info;
+        mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+
+        if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) != KERN_SUCCESS) {
+            return 0;
+        }
+
+        return (int64)info.resident_size;
+       #elif JUCE_WINDOWS
+        PROCESS_MEMORY_COUNTERS counters;
+
+        if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+            return 0;
+        }
+
+        return (int64)counters.WorkingSetSize;
+       #else
+        return 0;
+       #endif
+    }
+
+    // Bounded deque of node indices. The owning worker pushes and pops at the
+    // back, so it keeps working on the nodes it just made ready while they are
+    // in its cache, and idle workers steal from the front.
+    class WorkQueue
+    {
+    public:
+        void prepare(int capacity)
+        {
+            tasks.resize((size_t)capacity);
+            head = 0;
+            size = 0;
+        }
+
+        void push(int task)
+        {
+            const std::lock_guard<std::mutex> lock(mutex);
+            jassert(size < (int)tasks.size());
+
+            tasks[(size_t)((head + size) % (int)tasks.size())] = task;
+            ++size;
+        }
+
+        bool pop(int& task)
+        {
+            const std::lock_guard<std::mutex> lock(mutex);
+
+            if (size == 0) {
+                return false;
+            }
+
+            --size;
+            task = tasks[(size_t)((head + size) % (int)tasks.size())];
+            return true;
+        }
+
+        bool steal(int& task)
+        {
+            const std::lock_guard<std::mutex> lock(mutex);
+
+            if (size == 0) {
+                return false;
+            }
+
+            task = tasks[(size_t)head];
+            head = (head + 1) % (int)tasks.size();
+            --size;
+            return true;
+        }
+
+    private:
+        std::mutex mutex;
+        std::vector<int> tasks;
+        int head = 0;
+        int size = 0;
+    };
+
+    class RenderGraph
+    {
+    public:
+        explicit RenderGraph(const Options& optionsToUse)
+            : options(optionsToUse)
+            , numTracks((options.numInstances + options.chainLength - 1) / options.chainLength)
+        {
+            // The instances of a track in series, then the master bus
+            for (int index = 0; index < options.numInstances; ++index) {
+                auto node = std::make_unique<Node>();
+                node->track = index / options.chainLength;
+                node->numInputs = index % options.chainLength == 0 ? 0 : 1;
+
+                const auto lastInTrack = index % options.chainLength == options.chainLength - 1 || index == options.numInstances - 1;
+                node->successor = lastInTrack ? options.numInstances : index + 1;
+
+                nodes.push_back(std::move(node));
+            }
+
+            auto master = std::make_unique<Node>();
+            master->numInputs = numTracks;
+            master->successor = -1;
+            nodes.push_back(std::move(master));
+
+            trackBuffers.resize((size_t)numTracks);
+
+            for (auto& buffer : trackBuffers) {
+                buffer.setSize(options.numChannels, options.blockSize);
+            }
+
+            masterBuffer.setSize(options.numChannels, options.blockSize);
+
+            // Every track gets the same noise at its input
+            Random random(1234);
+            input.setSize(options.numChannels, options.blockSize);
+
+            for (int channel = 0; channel < options.numChannels; ++channel) {
+                for (int i = 0; i < options.blockSize; ++i) {
+                    input.setSample(channel, i, 0.5f * (2.0f * random.nextFloat() - 1.0f));
+                }
+            }
+        }
+
+        // Creates the processors. Before, the nodes of the instances pass their
+        // track through, so the graph also runs without what they add.
+        void prepareInstances()
+        {
+            const auto layout = getLayout(options.numChannels);
+
+            for (int index = 0; index < options.numInstances; ++index) {
+                auto& processor = nodes[(size_t)index]->processor;
+                processor = std::make_unique<Processor>();
+
+                // main has checked the layout before building the graph
+                const auto layoutApplied = processor->setBusesLayout(layout);
+                jassert(layoutApplied);
+                ignoreUnused(layoutApplied);
+
+                processor->setRateAndBufferSizeDetails(options.sampleRate, options.blockSize);
+                processor->prepareToPlay(options.sampleRate, options.blockSize);
+            }
+        }
+
+        ~RenderGraph()
+        {
+            stopWorkers();
+
+            for (auto& node : nodes) {
+                if (node->processor != nullptr) {
+                    node->processor->releaseResources();
+                }
+            }
+        }
+
+        // Worker 0 is the thread calling renderCycle, so only the others are started
+        void startWorkers(int numWorkers)
+        {
+            stopWorkers();
+
+            queues = std::vector<WorkQueue>((size_t)numWorkers);
+
+            for (auto& queue : queues) {
+                queue.prepare((int)nodes.size());
+            }
+
+            stop.store(false);
+
+            for (int worker = 1; worker < numWorkers; ++worker) {
+                workers.emplace_back([this, worker] { runWorker(worker); });
+            }
+        }
+
+        void stopWorkers()
+        {
+            stop.store(true);
+
+            for (auto& worker : workers) {
+                worker.join();
+            }
+
+            workers.clear();
+        }
+
+        // Renders one block of the whole graph and returns how long it took
+        double renderCycle()
+        {
+            ScopedNoDenormals noDenormals;
+            const auto startTicks = Time::getHighResolutionTicks();
+
+            for (auto& node : nodes) {
+                node->pendingInputs.store(node->numInputs, std::memory_order_relaxed);
+            }
+
+            cycleDone.store(false);
+
+            // Spread the track heads over the workers, like a host starting a cycle
+            for (int index = 0, worker = 0; index < options.numInstances; index += options.chainLength) {
+                queues[(size_t)worker].push(index);
+                worker = (worker + 1) % (int)queues.size();
+            }
+
+            // Work along until the master bus is done, like a host audio thread
+            while (!cycleDone.load(std::memory_order_acquire)) {
+                if (!runTask(0, cycleRandom)) {
+                    std::this_thread::yield();
+                }
+            }
+
+            return Time::highResolutionTicksToSeconds(Time::getHighResolutionTicks() - startTicks);
+        }
+
+        int getNumTracks() const
+        {
+            return numTracks;
+        }
+
+    private:
+        struct Node
+        {
+            std::unique_ptr<Processor> processor;
+            int track = 0;
+            int numInputs = 0;
+            int successor = -1;
+            std::atomic<int> pendingInputs { 0 };
+        };
+
+        void runWorker(int worker)
+        {
+            ScopedNoDenormals noDenormals;
+            Random random(worker);
+
+            while (!stop.load(std::memory_order_relaxed)) {
+                if (!runTask(worker, random)) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+
+        // Processes one node from the own queue or stolen from another, returns
+        // false if there was none
+        bool runTask(int worker, Random& random)
+        {
+            auto& ownQueue = queues[(size_t)worker];
+            int task = 0;
+
+            if (ownQueue.pop(task) || steal(worker, random, task)) {
+                process(task, ownQueue);
+                return true;
+            }
+
+            return false;
+        }
+
+        bool steal(int worker, Random& random, int& task)
+        {
+            const auto numQueues = (int)queues.size();
+            const auto start = random.nextInt(numQueues);
+
+            for (int i = 0; i < numQueues; ++i) {
+                const auto victim = (start + i) % numQueues;
+
+                if (victim != worker && queues[(size_t)victim].steal(task)) {
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        void process(int index, WorkQueue& ownQueue)
+        {
+            auto& node = *nodes[(size_t)index];
+
+            if (index < options.numInstances) {
+                auto& buffer = trackBuffers[(size_t)node.track];
+
+                // The head of a track reads the input, the rest process in place
+                if (node.numInputs == 0) {
+                    for (int channel = 0; channel < options.numChannels; ++channel) {
+                        buffer.copyFrom(channel, 0, input, channel, 0, options.blockSize);
+                    }
+                }
+
+                if (node.processor != nullptr) {
+                    MidiBuffer midiMessages;
+                    node.processor->processBlock(buffer, midiMessages);
+                }
+            }
+            else {
+                // Sum the tracks into the master bus
+                masterBuffer.clear();
+
+                for (auto& buffer : trackBuffers) {
+                    for (int channel = 0; channel < options.numChannels; ++channel) {
+                        masterBuffer.addFrom(channel, 0, buffer, channel, 0, options.blockSize);
+                    }
+                }
+
+                cycleDone.store(true, std::memory_order_release);
+                return;
+            }
+
+            // The node that delivers the last input makes its successor ready
+            if (nodes[(size_t)node.successor]->pendingInputs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                ownQueue.push(node.successor);
+            }
+        }
+
+        const Options options;
+        const int numTracks;
+
+        std::vector<std::unique_ptr<Node>> nodes;
+        std::vector<AudioBuffer<float>> trackBuffers;
+        AudioBuffer<float> masterBuffer;
+        AudioBuffer<float> input;
+
+        std::vector<WorkQueue> queues;
+        std::vector<std::thread> workers;
+        std::atomic<bool> stop { true };
+        std::atomic<bool> cycleDone { false };
+        Random cycleRandom { 0 };
+
+        JUCE_DECLARE_NON_COPYABLE (RenderGraph)
+    };
+
+    struct StepResult
+    {
+        int numWorkers = 0;
+        double realtimeFactor = 0.0;
+        double instanceBlocksPerSecond = 0.0;
+        double scalingEfficiency = 0.0;
+        double p50 = 0.0;
+        double p99 = 0.0;
+        double p999 = 0.0;
+        double maximum = 0.0;
+    };
+
+    StepResult runStep(RenderGraph& graph, int numWorkers, const Options& options)
+    {
+        graph.startWorkers(numWorkers);
+
+        // Warm up the caches and the branch predictors
+        for (int cycle = 0; cycle < jmin(100, options.numCycles); ++cycle) {
+            graph.renderCycle();
+        }
+
+        std::vector<double> cycleSeconds;
+        cycleSeconds.reserve((size_t)options.numCycles);
+        auto totalSeconds = 0.0;
+
+        for (int cycle = 0; cycle < options.numCycles; ++cycle) {
+            cycleSeconds.push_back(graph.renderCycle());
+            totalSeconds += cycleSeconds.back();
+        }
+
+        graph.stopWorkers();
+
+        std::sort(cycleSeconds.begin(), cycleSeconds.end());
+
+        auto percentile = [&cycleSeconds](double proportion) {
+            const auto index = jmin(cycleSeconds.size() - 1, (size_t)(proportion * (double)cycleSeconds.size()));
+            return cycleSeconds[index] * 1.0e6;
+        };
+
+        StepResult result;
+        result.numWorkers = numWorkers;
+        result.realtimeFactor = (double)options.numCycles * options.blockSize / options.sampleRate / totalSeconds;
+        result.instanceBlocksPerSecond = (double)options.numCycles * options.numInstances / totalSeconds;
+        result.p50 = percentile(0.5);
+        result.p99 = percentile(0.99);
+        result.p999 = percentile(0.999);
+        result.maximum = cycleSeconds.back() * 1.0e6;
+
+        return result;
+    }
+
+    var toJson(const std::vector<StepResult>& results, const Options& options, int numTracks, int64 residentBytesPerInstance)
+    {
+        auto context = BenchmarkHarness::createContext();
+        context->setProperty("instances", options.numInstances);
+        context->setProperty("tracks", numTracks);
+        context->setProperty("chain_length", options.chainLength);
+        context->setProperty("channels", options.numChannels);
+        context->setProperty("block_size", options.blockSize);
+        context->setProperty("sample_rate", options.sampleRate);
+        context->setProperty("cycles_per_step", options.numCycles);
+        context->setProperty("deadline_us", 1.0e6 * options.blockSize / options.sampleRate);
+        context->setProperty("processor_object_bytes", (int64)sizeof(Processor));
+        context->setProperty("resident_bytes_per_instance", residentBytesPerInstance);
+
+        Array<var> steps;
+
+        for (auto& result : results) {
+            auto* step = new DynamicObject();
+            step->setProperty("workers", result.numWorkers);
+            step->setProperty("realtime_factor", result.realtimeFactor);
+            step->setProperty("instance_blocks_per_second", result.instanceBlocksPerSecond);
+            step->setProperty("scaling_efficiency", result.scalingEfficiency);
+            step->setProperty("cycle_p50_us", result.p50);
+            step->setProperty("cycle_p99_us", result.p99);
+            step->setProperty("cycle_p999_us", result.p999);
+            step->setProperty("cycle_max_us", result.maximum);
+            steps.add(var(step));
+        }
+
+        auto* root = new DynamicObject();
+        root->setProperty("context", var(context.get()));
+        root->setProperty("steps", steps);
+
+        return var(root);
+    }
+
+    void printUsage()
+    {
+        std::cout << "Usage: RenderGraph [options]" << std::endl
+                  << "  --output=<file>         write the JSON results to a file instead of stdout" << std::endl
+                  << "  --instances=<n>         processor instances in the graph (default 128)" << std::endl
+                  << "  --chain-length=<n>      instances in series on every track (default 2)" << std::endl
+                  << "  --workers=<n>           largest worker count (default the logical cores)" << std::endl
+                  << "  --channels=<n>          channel count, up to 8 (default 2)" << std::endl
+                  << "  --block-size=<n>        samples per graph cycle (default 128)" << std::endl
+                  << "  --sample-rate=<hz>      processing sample rate (default 48000)" << std::endl
+                  << "  --cycles=<n>            measured graph cycles per worker count (default 2000)" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    ScopedJuceInitialiser_GUI juceInitialiser;
+    ArgumentList args(argc, argv);
+
+    if (args.containsOption("--help|-h")) {
+        printUsage();
+        return 0;
+    }
+
+    Options options;
+
+    if (args.containsOption("--instances")) {
+        options.numInstances = args.getValueForOption("--instances").getIntValue();
+    }
+
+    if (args.containsOption("--chain-length")) {
+        options.chainLength = args.getValueForOption("--chain-length").getIntValue();
+    }
+
+    if (args.containsOption("--workers")) {
+        options.maxWorkers = args.getValueForOption("--workers").getIntValue();
+    }
+
+    if (args.containsOption("--channels")) {
+        options.numChannels = args.getValueForOption("--channels").getIntValue();
+    }
+
+    if (args.containsOption("--block-size")) {
+        options.blockSize = args.getValueForOption("--block-size").getIntValue();
+    }
+
+    if (args.containsOption("--sample-rate")) {
+        options.sampleRate = args.getValueForOption("--sample-rate").getDoubleValue();
+    }
+
+    if (args.containsOption("--cycles")) {
+        options.numCycles = args.getValueForOption("--cycles").getIntValue();
+    }
+
+    if (options.numInstances <= 0 || options.chainLength <= 0 || options.maxWorkers <= 0 || options.numChannels <= 0
+        || options.blockSize <= 0 || options.sampleRate <= 0.0 || options.numCycles <= 0) {
+        printUsage();
+        return 1;
+    }
+
+    // A layout the processor rejects would quietly benchmark the default one
+    if (!Processor().setBusesLayout(getLayout(options.numChannels))) {
+        std::cerr << "Unsupported channel count: " << options.numChannels << std::endl;
+        return 1;
+    }
+
+    // The graph runs once without the instances and once with them prepared,
+    // so the buses, the queues and the workers are not counted per instance
+    RenderGraph graph(options);
+
+    graph.startWorkers(1);
+    graph.renderCycle();
+    graph.stopWorkers();
+
+    const auto residentBytesBefore = getResidentBytes();
+    graph.prepareInstances();
+
+    graph.startWorkers(1);
+    graph.renderCycle();
+    graph.stopWorkers();
+
+    const auto residentBytesPerInstance = (getResidentBytes() - residentBytesBefore) / options.numInstances;
+
+    // Doubling the workers up to the limit, and the limit itself
+    std::vector<StepResult> results;
+
+    for (int numWorkers = 1;; numWorkers = jmin(2 * numWorkers, options.maxWorkers)) {
+        results.push_back(runStep(graph, numWorkers, options));
+
+        // How much of the single worker throughput every worker adds
+        results.back().scalingEfficiency = results.back().realtimeFactor / (results.front().realtimeFactor * numWorkers);
+
+        // Progress goes to stderr so stdout can be piped as JSON
+        std::cerr << numWorkers << " workers: " << String(results.back().realtimeFactor, 2) << "x realtime, p99 cycle "
+                  << String(results.back().p99, 1) << " us" << std::endl;
+
+        if (numWorkers == options.maxWorkers) {
+            break;
+        }
+    }
+
+    const auto json = JSON::toString(toJson(results, options, graph.getNumTracks(), residentBytesPerInstance));
+
+    if (args.containsOption("--output")) {
+        const auto outputFile = args.getFileForOption("--output");
+
+        if (!outputFile.replaceWithText(json)) {
+            std::cerr << "Could not write " << outputFile.getFullPathName() << std::endl;
+            return 1;
+        }
+    }
+    else {
+        std::cout << json << std::endl;
+    }
+
+    return 0;
+}